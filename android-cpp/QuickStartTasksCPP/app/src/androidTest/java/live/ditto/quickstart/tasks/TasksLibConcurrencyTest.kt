@@ -0,0 +1,187 @@
+package live.ditto.quickstart.tasks
+
+import android.util.Log
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import live.ditto.quickstart.tasks.data.PackedTasksReader
+import org.junit.After
+import org.junit.Assert.*
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.nio.ByteBuffer
+import java.util.UUID
+import java.util.concurrent.CompletableFuture
+import java.util.concurrent.CountDownLatch
+import java.util.concurrent.Executors
+import java.util.concurrent.TimeUnit
+import java.util.concurrent.atomic.AtomicLong
+import java.util.concurrent.locks.ReentrantLock
+
+/**
+ * Stress tests for concurrent calls into TasksLib.
+ *
+ * These rely on TasksApplication having initialized Ditto. They verify that a slow tasks observer
+ * does not block other TasksLib calls, and measure call throughput from several threads with and
+ * without a slow observer.
+ *
+ * Each test works on a task that it creates and deletes, so the app's own tasks are left alone.
+ */
+@RunWith(AndroidJUnit4::class)
+class TasksLibConcurrencyTest {
+
+    companion object {
+        private const val TAG = "TasksLibConcurrencyTest"
+
+        private const val THREAD_COUNT = 4
+        private const val PHASE_DURATION_MS = 3_000L
+        private const val SLOW_OBSERVER_DELAY_MS = 50L
+    }
+
+    // ID of the task created for the test
+    private lateinit var taskId: String
+
+    @Before
+    fun setUp() {
+        taskId = createTestTask()
+    }
+
+    @After
+    fun tearDown() {
+        TasksLib.removeTasksObserver()
+        if (::taskId.isInitialized) {
+            TasksLib.deleteTask(taskId)
+        }
+    }
+
+    @Test
+    fun callsAreNotBlockedBySlowObserver() {
+        val inObserver = CountDownLatch(1)
+        val releaseObserver = CountDownLatch(1)
+        TasksLib.setPackedTasksObserver(object : PackedTasksObserver {
+            override fun onTasksUpdated(tasks: ByteBuffer) {
+                inObserver.countDown()
+                releaseObserver.await(30, TimeUnit.SECONDS)
+            }
+        })
+
+        val executor = Executors.newSingleThreadExecutor()
+        try {
+            assertTrue("observer was not invoked", inObserver.await(10, TimeUnit.SECONDS))
+
+            // The observer is now blocked in Kotlin; these calls must still complete.
+            val calls = executor.submit {
+                TasksLib.isSyncActive()
+                TasksLib.getTaskWithId(taskId)
+                TasksLib.toggleDoneState(taskId)
+                TasksLib.toggleDoneState(taskId)
+            }
+            calls.get(5, TimeUnit.SECONDS)
+        } finally {
+            releaseObserver.countDown()
+            executor.shutdownNow()
+        }
+    }
+
+    @Test
+    fun throughputWithSlowObserver() {
+        // Before the JNI entry points stopped sharing one recursive mutex, every call held it, and
+        // so did the observer while Kotlin handled an update. This phase runs the same calls
+        // through one lock in Kotlin, held by the observer too, to measure that behavior.
+        val globalLock = ReentrantLock()
+        TasksLib.setPackedTasksObserver(object : PackedTasksObserver {
+            override fun onTasksUpdated(tasks: ByteBuffer) {
+                globalLock.lock()
+                try {
+                    Thread.sleep(SLOW_OBSERVER_DELAY_MS)
+                } finally {
+                    globalLock.unlock()
+                }
+            }
+        })
+        val serialized = measureOpsPerSecond(globalLock)
+        TasksLib.removeTasksObserver()
+
+        val baseline = measureOpsPerSecond()
+
+        TasksLib.setPackedTasksObserver(object : PackedTasksObserver {
+            override fun onTasksUpdated(tasks: ByteBuffer) {
+                Thread.sleep(SLOW_OBSERVER_DELAY_MS)
+            }
+        })
+        val withSlowObserver = measureOpsPerSecond()
+
+        Log.i(TAG, "ops/s with $THREAD_COUNT threads: no observer: $baseline, " +
+                "observer taking $SLOW_OBSERVER_DELAY_MS ms: $withSlowObserver, " +
+                "same observer with calls serialized as before: $serialized")
+
+        // When every call waited for the observer, each write (which triggers an update) cost at
+        // least SLOW_OBSERVER_DELAY_MS, so throughput collapsed to a few operations per second.
+        assertTrue("no operations completed", baseline > 0)
+        assertTrue(
+            "throughput with slow observer ($withSlowObserver ops/s) is far below " +
+                    "baseline ($baseline ops/s)",
+            withSlowObserver * 2 >= baseline
+        )
+        assertTrue(
+            "throughput with slow observer ($withSlowObserver ops/s) is not above that with " +
+                    "serialized calls ($serialized ops/s)",
+            withSlowObserver > serialized
+        )
+    }
+
+    // Create a task with a unique title, and return its ID once it has been observed.
+    private fun createTestTask(): String {
+        val title = "$TAG ${UUID.randomUUID()}"
+        val created = CompletableFuture<String>()
+        TasksLib.setPackedTasksObserver(object : PackedTasksObserver {
+            override fun onTasksUpdated(tasks: ByteBuffer) {
+                val reader = PackedTasksReader(tasks)
+                for (i in 0 until reader.size) {
+                    if (reader.title(i) == title) {
+                        created.complete(reader.id(i))
+                    }
+                }
+            }
+        })
+        try {
+            TasksLib.createTask(title, false)
+            return created.get(10, TimeUnit.SECONDS)
+        } finally {
+            TasksLib.removeTasksObserver()
+        }
+    }
+
+    // Run a mix of reads and writes from several threads, and return completed calls per second.
+    //
+    // If lock is given, each call holds it.
+    private fun measureOpsPerSecond(lock: ReentrantLock? = null): Long {
+        val ops = AtomicLong()
+        val deadline = System.nanoTime() + TimeUnit.MILLISECONDS.toNanos(PHASE_DURATION_MS)
+        val executor = Executors.newFixedThreadPool(THREAD_COUNT)
+        try {
+            val futures = (0 until THREAD_COUNT).map { thread ->
+                executor.submit {
+                    var i = 0
+                    while (System.nanoTime() < deadline) {
+                        lock?.lock()
+                        try {
+                            when (i++ % 4) {
+                                0 -> TasksLib.isSyncActive()
+                                1 -> TasksLib.getTaskWithId(taskId)
+                                2 -> TasksLib.updateTask(taskId, "$TAG task", thread % 2 == 0)
+                                else -> TasksLib.getTaskWithId(taskId)
+                            }
+                        } finally {
+                            lock?.unlock()
+                        }
+                        ops.incrementAndGet()
+                    }
+                }
+            }
+            futures.forEach { it.get(PHASE_DURATION_MS * 10, TimeUnit.MILLISECONDS) }
+        } finally {
+            executor.shutdownNow()
+        }
+        return ops.get() * 1000 / PHASE_DURATION_MS
+    }
+}
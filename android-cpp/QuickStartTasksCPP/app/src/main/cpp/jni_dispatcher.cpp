@@ -0,0 +1,99 @@
+#include "jni_dispatcher.h"
+
+#include <android/log.h>
+
+#include <exception>
+#include <utility>
+
+namespace {
+
+constexpr const char *TAG = "jni_dispatcher";
+
+} // end anonymous namespace
+
+JniDispatcher::JniDispatcher(JavaVM *vm, const char *thread_name)
+    : state(std::make_shared<State>(vm)),
+      thread([state = state, thread_name] { run(state, thread_name); }) {}
+
+JniDispatcher::~JniDispatcher() noexcept { stop(); }
+
+void JniDispatcher::post(Delivery delivery) {
+  {
+    std::lock_guard<std::mutex> lock(state->mtx);
+    if (state->stopping) {
+      return;
+    }
+    if (state->pending) {
+      ++state->coalesced;
+    }
+    state->pending = std::move(delivery);
+  }
+  state->cv.notify_one();
+}
+
+void JniDispatcher::stop() noexcept {
+  Delivery discarded;
+  {
+    std::lock_guard<std::mutex> lock(state->mtx);
+    state->stopping = true;
+    discarded = std::move(state->pending);
+    state->pending = nullptr;
+  }
+  state->cv.notify_all();
+  if (!thread.joinable()) {
+    return;
+  }
+  if (thread.get_id() == std::this_thread::get_id()) {
+    // Called from a delivery, which would wait for itself.  The thread keeps the state alive,
+    // and ends once the delivery returns.
+    thread.detach();
+  } else {
+    thread.join();
+  }
+}
+
+std::size_t JniDispatcher::coalesced_count() const {
+  std::lock_guard<std::mutex> lock(state->mtx);
+  return state->coalesced;
+}
+
+void JniDispatcher::run(const std::shared_ptr<State> &state, const char *thread_name) {
+  JNIEnv *env = nullptr;
+  JavaVMAttachArgs args{JNI_VERSION_1_6, thread_name, nullptr};
+  if (state->vm->AttachCurrentThread(&env, &args) != JNI_OK || env == nullptr) {
+    __android_log_print(ANDROID_LOG_ERROR, TAG, "AttachCurrentThread failed");
+    std::lock_guard<std::mutex> lock(state->mtx);
+    state->stopping = true;
+    state->pending = nullptr;
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(state->mtx);
+  for (;;) {
+    state->cv.wait(lock, [&state] { return state->stopping || state->pending; });
+    if (state->stopping) {
+      break;
+    }
+
+    auto delivery = std::move(state->pending);
+    state->pending = nullptr;
+    lock.unlock();
+    try {
+      delivery(env);
+    } catch (const std::exception &err) {
+      __android_log_print(ANDROID_LOG_ERROR, TAG, "error in delivery: %s", err.what());
+    }
+    // An exception thrown by the Java observer must not be left pending on this thread, because
+    // it would cause every later JNI call here to fail.
+    if (env->ExceptionCheck()) {
+      __android_log_print(ANDROID_LOG_ERROR, TAG, "Java exception thrown by observer");
+      env->ExceptionDescribe();
+      env->ExceptionClear();
+    }
+    delivery = nullptr; // release captured data before waiting again
+    lock.lock();
+  }
+  lock.unlock();
+
+  state->vm->DetachCurrentThread();
+}
@@ -0,0 +1,78 @@
+#ifndef QUICKSTARTTASKSCPP_JNI_DISPATCHER_H
+#define QUICKSTARTTASKSCPP_JNI_DISPATCHER_H
+
+#include <jni.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/// Invokes Java code from a dedicated native thread that is attached to the Java VM once, for
+/// its whole lifetime.
+///
+/// Attaching and detaching a thread creates and destroys a java.lang.Thread object, so doing that
+/// for every observer callback is expensive when updates arrive rapidly.  Instead, observer
+/// callbacks post deliveries to a JniDispatcher, which runs them on its thread.
+///
+/// Deliveries are coalesced: if a delivery is posted while another is still waiting to run, the
+/// waiting one is discarded.  This is intended for snapshots, where only the latest one matters,
+/// and it keeps a slow Java observer from falling further and further behind.
+class JniDispatcher {
+public:
+  /// A function to be run on the dispatcher thread, with that thread's JNI environment.
+  using Delivery = std::function<void(JNIEnv *env)>;
+
+  /// Start the dispatcher thread, which attaches itself to the given Java VM.
+  explicit JniDispatcher(JavaVM *vm, const char *thread_name = "TasksObserver");
+
+  /// Stop the dispatcher thread, as if by stop().
+  ~JniDispatcher() noexcept;
+
+  /// Queue a delivery, replacing any queued delivery that has not started yet.
+  ///
+  /// Deliveries posted after stop() has been called are ignored.
+  void post(Delivery delivery);
+
+  /// Discard any queued delivery, wait for a running delivery to complete, and then detach and
+  /// end the dispatcher thread.
+  ///
+  /// If this is called from a delivery (for example, when a Java observer removes itself), it
+  /// cannot wait for that delivery, so it returns at once; the thread ends when the delivery
+  /// returns, and no further deliveries are run.
+  void stop() noexcept;
+
+  /// Return the number of deliveries that were discarded because a newer one was posted.
+  std::size_t coalesced_count() const;
+
+  JniDispatcher(const JniDispatcher &) = delete;
+
+  JniDispatcher(JniDispatcher &&) = delete;
+
+  JniDispatcher &operator=(const JniDispatcher &) = delete;
+
+  JniDispatcher &operator=(JniDispatcher &&) = delete;
+
+private:
+  // State shared with the dispatcher thread.  The thread holds its own reference, so that it can
+  // outlive the JniDispatcher when stop() is called from a delivery.
+  struct State {
+    explicit State(JavaVM *vm) : vm(vm) {}
+
+    JavaVM *vm;
+    std::mutex mtx;
+    std::condition_variable cv;
+    Delivery pending; // empty if there is nothing queued
+    bool stopping = false;
+    std::size_t coalesced = 0;
+  };
+
+  static void run(const std::shared_ptr<State> &state, const char *thread_name);
+
+  const std::shared_ptr<State> state;
+  std::thread thread; // declared last, so it starts after the other members are initialized
+};
+
+#endif //QUICKSTARTTASKSCPP_JNI_DISPATCHER_H
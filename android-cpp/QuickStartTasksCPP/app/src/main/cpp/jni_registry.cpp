@@ -0,0 +1,90 @@
+#include "jni_registry.h"
+
+#include <atomic>
+#include <stdexcept>
+
+namespace {
+
+JniRegistry registry{};
+
+// Set after all members of the registry have been resolved, and cleared before they are released.
+std::atomic<bool> loaded{false};
+
+// Find a class and replace the local reference with a global reference.
+bool find_global_class(JNIEnv *env, const char *name, jclass &global_class) {
+  jclass local_class = env->FindClass(name);
+  if (local_class == nullptr) {
+    return false;
+  }
+  global_class = static_cast<jclass>(env->NewGlobalRef(local_class));
+  env->DeleteLocalRef(local_class);
+  return global_class != nullptr;
+}
+
+void release_global_class(JNIEnv *env, jclass &global_class) {
+  if (global_class != nullptr) {
+    env->DeleteGlobalRef(global_class);
+    global_class = nullptr;
+  }
+}
+
+void release_all(JNIEnv *env) {
+  release_global_class(env, registry.string_class);
+  release_global_class(env, registry.exception_class);
+  release_global_class(env, registry.illegal_state_exception_class);
+  release_global_class(env, registry.illegal_argument_exception_class);
+  release_global_class(env, registry.task_class);
+  release_global_class(env, registry.tasks_observer_class);
+  release_global_class(env, registry.packed_tasks_observer_class);
+  registry = JniRegistry{};
+}
+
+} // end anonymous namespace
+
+bool jni_registry_load(JNIEnv *env) {
+  loaded = false;
+  release_all(env);
+
+  const bool ok =
+      find_global_class(env, "java/lang/String", registry.string_class) &&
+      find_global_class(env, "java/lang/Exception", registry.exception_class) &&
+      find_global_class(env, "java/lang/IllegalStateException",
+                        registry.illegal_state_exception_class) &&
+      find_global_class(env, "java/lang/IllegalArgumentException",
+                        registry.illegal_argument_exception_class) &&
+      find_global_class(env, "live/ditto/quickstart/tasks/data/Task", registry.task_class) &&
+      (registry.task_ctor = env->GetMethodID(registry.task_class, "<init>",
+                                             "(Ljava/lang/String;Ljava/lang/String;ZZ)V")) !=
+      nullptr &&
+      find_global_class(env, "live/ditto/quickstart/tasks/TasksObserver",
+                        registry.tasks_observer_class) &&
+      (registry.tasks_observer_on_tasks_updated =
+           env->GetMethodID(registry.tasks_observer_class, "onTasksUpdated",
+                            "([Ljava/lang/String;)V")) != nullptr &&
+      find_global_class(env, "live/ditto/quickstart/tasks/PackedTasksObserver",
+                        registry.packed_tasks_observer_class) &&
+      (registry.packed_tasks_observer_on_tasks_updated =
+           env->GetMethodID(registry.packed_tasks_observer_class, "onTasksUpdated",
+                            "(Ljava/nio/ByteBuffer;)V")) != nullptr;
+
+  if (!ok) {
+    release_all(env);
+    return false;
+  }
+  loaded = true;
+  return true;
+}
+
+void jni_registry_unload(JNIEnv *env) {
+  loaded = false;
+  release_all(env);
+}
+
+const JniRegistry &jni_registry() {
+  if (!loaded) {
+    throw std::logic_error("JNI registry has not been loaded");
+  }
+  return registry;
+}
+
+bool jni_registry_is_loaded() { return loaded; }
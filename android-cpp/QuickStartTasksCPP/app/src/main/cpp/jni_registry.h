@@ -0,0 +1,66 @@
+#ifndef QUICKSTARTTASKSCPP_JNI_REGISTRY_H
+#define QUICKSTARTTASKSCPP_JNI_REGISTRY_H
+
+#include <jni.h>
+
+/// Java classes and method IDs used by the JNI bridge.
+///
+/// Looking up classes and methods through JNI is relatively expensive, so they are resolved once
+/// when the library is loaded, rather than on every call.  Classes are held as global references,
+/// so the method IDs remain valid until the library is unloaded.
+///
+/// `FindClass` only finds application classes when it is called from a thread that was started by
+/// Java (or from `JNI_OnLoad`), so these lookups could not be done lazily from the native threads
+/// on which Ditto invokes observer callbacks.
+struct JniRegistry {
+  /// java.lang.String
+  jclass string_class;
+
+  /// java.lang.Exception
+  jclass exception_class;
+
+  /// java.lang.IllegalStateException
+  jclass illegal_state_exception_class;
+
+  /// java.lang.IllegalArgumentException
+  jclass illegal_argument_exception_class;
+
+  /// live.ditto.quickstart.tasks.data.Task
+  jclass task_class;
+
+  /// Task(String _id, String title, boolean done, boolean deleted)
+  jmethodID task_ctor;
+
+  /// live.ditto.quickstart.tasks.TasksObserver
+  jclass tasks_observer_class;
+
+  /// TasksObserver.onTasksUpdated(String[] tasksJson)
+  jmethodID tasks_observer_on_tasks_updated;
+
+  /// live.ditto.quickstart.tasks.PackedTasksObserver
+  jclass packed_tasks_observer_class;
+
+  /// PackedTasksObserver.onTasksUpdated(ByteBuffer tasks)
+  jmethodID packed_tasks_observer_on_tasks_updated;
+};
+
+/// Resolve all the classes and methods in the registry.
+///
+/// This must be called from `JNI_OnLoad`.  If a lookup fails, a Java exception is pending, all
+/// references obtained so far are released, and false is returned.
+bool jni_registry_load(JNIEnv *env);
+
+/// Release the global references held by the registry.
+///
+/// This must be called from `JNI_OnUnload`.
+void jni_registry_unload(JNIEnv *env);
+
+/// Return the registry.
+///
+/// Throws `std::logic_error` if `jni_registry_load()` has not succeeded.
+const JniRegistry &jni_registry();
+
+/// Return true if `jni_registry_load()` has succeeded and the registry has not been unloaded.
+bool jni_registry_is_loaded();
+
+#endif //QUICKSTARTTASKSCPP_JNI_REGISTRY_H
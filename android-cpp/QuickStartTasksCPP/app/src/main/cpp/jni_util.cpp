@@ -1,45 +1,93 @@
 #include "jni_util.h"
+#include "jni_registry.h"
+#include "utf_transcode.h"
+
+#include <cstdint>
+
+static_assert(sizeof(jchar) == sizeof(std::uint16_t), "jchar must be a UTF-16 code unit");
+
+namespace {
+
+// Throw an exception of a class held by the JNI registry, falling back to looking the class up by
+// name if the registry has not been loaded.
+void throw_registered_exception(JNIEnv *env, const char *msg, jclass JniRegistry::*exception_class,
+                                const char *exception_class_name) {
+  if (jni_registry_is_loaded()) {
+    env->ThrowNew(jni_registry().*exception_class, msg);
+  } else {
+    throw_java_exception(env, msg, exception_class_name);
+  }
+}
+
+} // end anonymous namespace
 
-/// Convert a Java String to a C++ std::string
 std::string jstring_to_string(JNIEnv *env, jstring js) {
   if (js == nullptr) {
     throw std::invalid_argument("null jstring passed");
   }
-  const char *utf = env->GetStringUTFChars(js, nullptr);
-  if (utf == nullptr) {
-    throw std::runtime_error("Failed to convert jstring to UTF-8");
-  }
 
-  try {
-    auto result = std::string(utf);
-    env->ReleaseStringUTFChars(js, utf);
-    return result;
-  } catch (...) {
-    env->ReleaseStringUTFChars(js, utf);
-    throw;
+  // Most strings are short, so they are copied to the stack.  Longer ones are copied to a buffer
+  // that is reused by each thread.
+  constexpr jsize STACK_BUFFER_LENGTH = 256;
+  jchar stack_buffer[STACK_BUFFER_LENGTH];
+  thread_local std::vector<jchar> heap_buffer;
+
+  const auto length = env->GetStringLength(js);
+  jchar *chars = stack_buffer;
+  if (length > STACK_BUFFER_LENGTH) {
+    heap_buffer.resize(static_cast<std::size_t>(length));
+    chars = heap_buffer.data();
   }
+  env->GetStringRegion(js, 0, length, chars);
+  if (env->ExceptionCheck()) {
+    throw std::runtime_error("Failed to read jstring");
+  }
+
+  std::string result;
+  utf16_to_utf8(reinterpret_cast<const std::uint16_t *>(chars), static_cast<std::size_t>(length),
+                result);
+  return result;
+}
+
+jstring utf8_to_jstring(JNIEnv *env, const char *utf8, std::size_t length) {
+  thread_local std::vector<std::uint16_t> utf16;
+  utf8_to_utf16(utf8, length, utf16);
+
+  static const jchar empty = 0;
+  const auto *chars = utf16.empty() ? &empty : reinterpret_cast<const jchar *>(utf16.data());
+  return env->NewString(chars, static_cast<jsize>(utf16.size()));
 }
 
 void throw_java_exception(JNIEnv *env, const char *msg,
                           const char *exception_class_name) {
-  jclass exception_class = (*env).FindClass(exception_class_name);
-  (*env).ThrowNew(exception_class, msg);
+  TempLocalRef<jclass> exception_class(env, env->FindClass(exception_class_name));
+  if (exception_class.get() != nullptr) {
+    env->ThrowNew(exception_class.get(), msg);
+  }
+}
+
+void throw_java_exception(JNIEnv *env, const char *msg) {
+  throw_registered_exception(env, msg, &JniRegistry::exception_class, "java/lang/Exception");
 }
 
 void throw_java_illegal_state_exception(JNIEnv *env, const char *msg) {
-  throw_java_exception(env, msg, "java/lang/IllegalStateException");
+  throw_registered_exception(env, msg, &JniRegistry::illegal_state_exception_class,
+                             "java/lang/IllegalStateException");
 }
 
 void throw_java_illegal_argument_exception(JNIEnv *env, const char *msg) {
-  throw_java_exception(env, msg, "java/lang/IllegalArgumentException");
+  throw_registered_exception(env, msg, &JniRegistry::illegal_argument_exception_class,
+                             "java/lang/IllegalArgumentException");
 }
 
 jobjectArray strings_to_jstrings(JNIEnv *env, const std::vector<std::string> &strings) {
   const auto count = (int) strings.size();
-  TempLocalRef<jclass> stringClass(env, env->FindClass("java/lang/String"));
   jobjectArray stringArray = env->NewObjectArray(count,
-                                                 stringClass.get(),
+                                                 jni_registry().string_class,
                                                  nullptr);
+  if (stringArray == nullptr) {
+    throw std::runtime_error("NewObjectArray failed");
+  }
   for (auto i = 0; i < count; ++i) {
     TempJString js(env, strings[i]);
     env->SetObjectArrayElement(stringArray, i, js.get());
@@ -3,19 +3,32 @@
 
 #include <jni.h>
 
+#include <cstddef>
+#include <cstring>
 #include <string>
 #include <stdexcept>
 #include <vector>
 
-/// Convert a Java String to a C++ std::string
+/// Convert a Java String to a C++ std::string, encoded as standard UTF-8.
+///
+/// Unlike `GetStringUTFChars()`, which produces modified UTF-8, this encodes supplementary
+/// characters (such as emoji) as 4-byte sequences.
 std::string jstring_to_string(JNIEnv *env, jstring js);
 
+/// Convert standard UTF-8 to a new Java String.
+///
+/// Unlike `NewStringUTF()`, this accepts 4-byte sequences.  Malformed input is replaced with
+/// U+FFFD.  Returns a local reference, or null with a Java exception pending if allocation fails.
+jstring utf8_to_jstring(JNIEnv *env, const char *utf8, std::size_t length);
+
 /// Convert a C++ bool to JNI boolean
 inline jboolean bool_to_jboolean(bool b) { return b ? JNI_TRUE : JNI_FALSE; }
 
-/// Throw a Java exception from a JNI function.
-void throw_java_exception(JNIEnv *env, const char *msg,
-                          const char *exception_class_name = "java/lang/Exception");
+/// Throw a java.lang.Exception from a JNI function.
+void throw_java_exception(JNIEnv *env, const char *msg);
+
+/// Throw a Java exception of the named class from a JNI function.
+void throw_java_exception(JNIEnv *env, const char *msg, const char *exception_class_name);
 
 /// Throw a java.lang.IllegalStateException
 void throw_java_illegal_state_exception(JNIEnv *env, const char *msg);
@@ -26,6 +39,7 @@ void throw_java_illegal_argument_exception(JNIEnv *env, const char *msg);
 /// Convert a collection of C++ strings to an array of Java Strings.
 ///
 /// The caller is responsible for eventually calling env->DeleteLocalRef() on the returned array.
+/// The JNI registry must have been loaded.
 jobjectArray strings_to_jstrings(JNIEnv *env, const std::vector<std::string> &strings);
 
 /// Takes ownership of a local reference to a Java object, and releases it upon destruction
@@ -63,19 +77,25 @@ private:
 /// Converts a C++ string to an owned `jstring`, which will be freed upon destruction.
 class TempJString {
 public:
-  /// Convert the given null-terminated UTF8 string to a `jstring`.
+  /// Convert the given UTF-8 string to a `jstring`.
   ///
   /// The `env` pointer must remain valid until the destructor has been called.
-  TempJString(JNIEnv *env, const char *c_str) : js(env, env->NewStringUTF(c_str)) {
+  TempJString(JNIEnv *env, const char *utf8, std::size_t length)
+      : js(env, utf8_to_jstring(env, utf8, length)) {
     if (js.get() == nullptr) {
-      throw std::runtime_error("NewStringUTF failed");
+      throw std::runtime_error("NewString failed");
     }
   }
 
+  /// Convert the given null-terminated UTF-8 string to a `jstring`.
+  ///
+  /// The `env` pointer must remain valid until the destructor has been called.
+  TempJString(JNIEnv *env, const char *c_str) : TempJString(env, c_str, std::strlen(c_str)) {}
+
   /// Convert the given `std::string` to a `jstring`.
   ///
   /// The `env` pointer must remain valid until the destructor has been called.
-  TempJString(JNIEnv *env, const std::string &s) : TempJString(env, s.c_str()) {}
+  TempJString(JNIEnv *env, const std::string &s) : TempJString(env, s.data(), s.size()) {}
 
   /// Return converted `jstring`
   ///
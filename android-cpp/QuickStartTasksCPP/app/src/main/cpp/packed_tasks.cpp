@@ -0,0 +1,53 @@
+#include "packed_tasks.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Size of a record, excluding its entry in the offset table.
+std::size_t record_size(const Task &task) {
+  return 1 + 4 + task._id.size() + 4 + task.title.size();
+}
+
+std::uint8_t *put_u32(std::uint8_t *out, std::uint32_t value) {
+  out[0] = static_cast<std::uint8_t>(value);
+  out[1] = static_cast<std::uint8_t>(value >> 8);
+  out[2] = static_cast<std::uint8_t>(value >> 16);
+  out[3] = static_cast<std::uint8_t>(value >> 24);
+  return out + 4;
+}
+
+std::uint8_t *put_string(std::uint8_t *out, const std::string &s) {
+  out = put_u32(out, static_cast<std::uint32_t>(s.size()));
+  std::memcpy(out, s.data(), s.size());
+  return out + s.size();
+}
+
+} // end anonymous namespace
+
+void pack_tasks(const std::vector<Task> &tasks, std::vector<std::uint8_t> &buffer) {
+  std::size_t total_size = PACKED_TASKS_HEADER_SIZE + 4 * tasks.size();
+  for (const auto &task: tasks) {
+    total_size += record_size(task);
+  }
+  if (total_size > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::length_error("tasks snapshot is too large to pack");
+  }
+
+  buffer.resize(total_size);
+  auto *const base = buffer.data();
+
+  auto *out = put_u32(base, PACKED_TASKS_MAGIC);
+  out = put_u32(out, static_cast<std::uint32_t>(tasks.size()));
+
+  auto *offset_table = out;
+  out += 4 * tasks.size();
+  for (const auto &task: tasks) {
+    offset_table = put_u32(offset_table, static_cast<std::uint32_t>(out - base));
+    *out++ = (task.done ? PACKED_TASK_DONE : 0) | (task.deleted ? PACKED_TASK_DELETED : 0);
+    out = put_string(out, task._id);
+    out = put_string(out, task.title);
+  }
+}
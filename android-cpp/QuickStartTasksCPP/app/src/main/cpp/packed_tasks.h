@@ -0,0 +1,37 @@
+#ifndef DITTO_QUICKSTART_PACKED_TASKS_H
+#define DITTO_QUICKSTART_PACKED_TASKS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "task.h"
+
+/// Binary encoding of a snapshot of tasks, which is passed to Kotlin in a single direct
+/// `java.nio.ByteBuffer` and decoded there by `PackedTasksReader`.
+///
+/// All integers are unsigned and little-endian.  The layout is:
+///
+/// - Header: `u32` magic number (`PACKED_TASKS_MAGIC`), `u32` task count
+/// - Offset table: one `u32` per task, the byte offset of its record from the start of the buffer
+/// - Records, one per task:
+///   - `u8` flags (`PACKED_TASK_DONE`, `PACKED_TASK_DELETED`)
+///   - `u32` length of the ID, followed by the ID as UTF-8
+///   - `u32` length of the title, followed by the title as UTF-8
+///
+/// If this format is changed, PackedTasksReader.kt must be updated to match.
+constexpr std::uint32_t PACKED_TASKS_MAGIC = 0x314B5354; // "TSK1" when read as bytes
+
+constexpr std::uint32_t PACKED_TASKS_HEADER_SIZE = 8;
+
+constexpr std::uint8_t PACKED_TASK_DONE = 0x01;
+constexpr std::uint8_t PACKED_TASK_DELETED = 0x02;
+
+/// Encode tasks into the packed format, replacing the contents of `buffer`.
+///
+/// The buffer's capacity is reused, so passing the same buffer for each snapshot avoids
+/// reallocation once it has grown to the size of the largest snapshot.
+///
+/// @throws std::length_error if the encoding would exceed 4 GiB.
+void pack_tasks(const std::vector<Task> &tasks, std::vector<std::uint8_t> &buffer);
+
+#endif // DITTO_QUICKSTART_PACKED_TASKS_H
@@ -1,5 +1,7 @@
 #include "task.h"
 
+#include <chrono>
+
 void to_json(nlohmann::json &j, const Task &task) {
   j = nlohmann::json{
       {"title", task.title}, {"done", task.done}, {"deleted", task.deleted}};
@@ -14,3 +16,8 @@ void from_json(const nlohmann::json &j, Task &task) {
   task.done = j.value("done", false);
   task.deleted = j.value("deleted", false);
 }
+
+std::int64_t task_timestamp_now() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
@@ -1,6 +1,7 @@
 #ifndef DITTO_QUICKSTART_TASK_H
 #define DITTO_QUICKSTART_TASK_H
 
+#include <cstdint>
 #include <string>
 
 #include "Ditto.h"
@@ -39,4 +40,11 @@ void to_json(nlohmann::json &j, const Task &task);
 /// Copies data from a JSON object to a Task.
 void from_json(const nlohmann::json &j, Task &task);
 
+/// Return the current time in the form used for the `created_at` and `modified_at` properties
+/// that TasksPeer sets when it changes a task: milliseconds since the Unix epoch.
+///
+/// These match the properties written by the console app, so that a task changed on this device is
+/// seen as changed by peers that read tasks by modification time.
+std::int64_t task_timestamp_now();
+
 #endif // DITTO_QUICKSTART_TASK_H
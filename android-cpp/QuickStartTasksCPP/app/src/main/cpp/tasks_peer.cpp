@@ -16,6 +16,10 @@ using json = nlohmann::json;
 
 namespace {
 
+/// Number of times `TasksPeer::toggle_task()` tries both statuses before concluding that the task
+/// does not exist.
+constexpr int TOGGLE_ATTEMPTS = 2;
+
 /// Extract a Task object from a QueryResultItem.
 Task task_from(const ditto::QueryResultItem &item) {
   return json::parse(item.json_string()).template get<Task>();
@@ -32,6 +36,15 @@ vector<string> tasks_json_from(const ditto::QueryResult &result) {
   return tasks;
 }
 
+/// Decode a QueryResult into tasks, reusing the elements of the given vector.
+void tasks_from(const ditto::QueryResult &result, vector<Task> &tasks) {
+  const auto item_count = result.item_count();
+  tasks.resize(item_count);
+  for (size_t i = 0; i < item_count; ++i) {
+    tasks[i] = task_from(result.get_item(i));
+  }
+}
+
 /// Initialize a Ditto instance.
 unique_ptr<ditto::Ditto> init_ditto(JNIEnv *env,
                                     jobject android_context,
@@ -54,8 +67,13 @@ unique_ptr<ditto::Ditto> init_ditto(JNIEnv *env,
         std::move(custom_url)
         );
 
+#ifdef DITTO_QUICKSTART_HOST_JVM
+    // The desktop SDK used by the host-jvm harness has no Android context parameter.
+    auto ditto = make_unique<ditto::Ditto>(identity, std::move(persistence_dir));
+#else
     auto ditto =
         make_unique<ditto::Ditto>(android_context, identity, std::move(persistence_dir));
+#endif
 
     if (is_running_on_emulator) {
       // Some transports don't work correctly on emulator, so disable them.
@@ -89,6 +107,8 @@ unique_ptr<ditto::Ditto> init_ditto(JNIEnv *env,
 // Private implementation of the TasksPeer class.
 class TasksPeer::Impl { // NOLINT(cppcoreguidelines-special-member-functions)
 private:
+  // Protects the sync state (tasks_subscription).  Store operations don't need to be serialized,
+  // as the Ditto store may be used from multiple threads concurrently.
   unique_ptr<mutex> mtx;
   unique_ptr<ditto::Ditto> ditto;
   shared_ptr<ditto::SyncSubscription> tasks_subscription;
@@ -127,6 +147,7 @@ public:
   }
 
   void start_sync() {
+    lock_guard<mutex> lock(*mtx);
     if (is_sync_active()) {
       return;
     }
@@ -137,6 +158,7 @@ public:
   }
 
   void stop_sync() {
+    lock_guard<mutex> lock(*mtx);
     if (!is_sync_active()) {
       return;
     }
@@ -150,10 +172,13 @@ public:
 
   string add_task(const string &title, bool done) {
     try {
+      const auto now = task_timestamp_now();
       const json task_args = {
-          {"title",   title},
-          {"done",    done},
-          {"deleted", false}};
+          {"title",       title},
+          {"done",        done},
+          {"deleted",     false},
+          {"created_at",  now},
+          {"modified_at", now}};
       const auto command = "INSERT INTO tasks DOCUMENTS (:newTask)";
       const auto result =
           ditto->get_store().execute(command, {{"newTask", task_args}});
@@ -168,8 +193,6 @@ public:
 
   Task get_task(const string &task_id) {
     try {
-      lock_guard<mutex> lock(*mtx);
-
       if (task_id.empty()) {
         throw invalid_argument("task_id must not be empty");
       }
@@ -196,18 +219,18 @@ public:
 
   void update_task(const Task &task) {
     try {
-      lock_guard<mutex> lock(*mtx);
-
       const auto stmt = "UPDATE tasks SET"
                         " title = :title,"
                         " done = :done,"
-                        " deleted = :deleted"
+                        " deleted = :deleted,"
+                        " modified_at = :modifiedAt"
                         " WHERE _id = :id";
       const auto result =
-          ditto->get_store().execute(stmt, {{"title",   task.title},
-                                            {"done",    task.done},
-                                            {"deleted", task.deleted},
-                                            {"id",      task._id}});
+          ditto->get_store().execute(stmt, {{"title",      task.title},
+                                            {"done",       task.done},
+                                            {"deleted",    task.deleted},
+                                            {"modifiedAt", task_timestamp_now()},
+                                            {"id",         task._id}});
       if (result.mutated_document_ids().empty()) {
         throw runtime_error("task not found with ID: " + task._id);
       }
@@ -220,16 +243,16 @@ public:
 
   void mark_task_complete(const string &task_id, bool done) {
     try {
-      lock_guard<mutex> lock(*mtx);
-
       if (task_id.empty()) {
         throw invalid_argument("task ID must not be empty");
       }
 
-      const auto stmt = "UPDATE tasks SET done = :done WHERE _id = :id";
+      const auto stmt = "UPDATE tasks SET done = :done, modified_at = :modifiedAt"
+                        " WHERE _id = :id";
       const auto result =
-          ditto->get_store().execute(stmt, {{"done", done},
-                                            {"id",   task_id}});
+          ditto->get_store().execute(stmt, {{"done",       done},
+                                            {"modifiedAt", task_timestamp_now()},
+                                            {"id",         task_id}});
       log_debug("Marked task " + task_id +
                 (done ? " complete" : " incomplete"));
     } catch (const exception &err) {
@@ -239,16 +262,49 @@ public:
     }
   }
 
-  void delete_task(const string &task_id) {
+  bool toggle_task(const string &task_id) {
     try {
-      lock_guard<mutex> lock(*mtx);
+      if (task_id.empty()) {
+        throw invalid_argument("task ID must not be empty");
+      }
 
+      // An UPDATE reports only which documents it changed, so `SET done = NOT done` could not
+      // tell the caller the new status.  Instead, each statement sets one status, only if the task
+      // has the other one, and whether it changed the task gives the new status.  A task with no
+      // `done` property is treated as not done.  If neither statement matches, the task was
+      // deleted, or toggled by another peer in between; that is retried once.
+      const auto stmt = "UPDATE tasks SET done = :done, modified_at = :modifiedAt"
+                        " WHERE _id = :id AND NOT deleted AND coalesce(done, false) = :expectedDone";
+      for (int attempt = 0; attempt < TOGGLE_ATTEMPTS; ++attempt) {
+        for (const bool done : {true, false}) {
+          const auto result = ditto->get_store().execute(
+              stmt, {{"done", done},
+                     {"modifiedAt", task_timestamp_now()},
+                     {"id", task_id},
+                     {"expectedDone", !done}});
+          if (!result.mutated_document_ids().empty()) {
+            log_debug("Toggled task " + task_id + (done ? " complete" : " incomplete"));
+            return done;
+          }
+        }
+      }
+      throw runtime_error("task not found with ID: " + task_id);
+    } catch (const exception &err) {
+      log_error("Failed to toggle task: " + string(err.what()));
+      throw runtime_error("unable to toggle task: " + string(err.what()));
+    }
+  }
+
+  void delete_task(const string &task_id) {
+    try {
       if (task_id.empty()) {
         throw invalid_argument("task ID must not be empty");
       }
 
-      const auto stmt = "UPDATE tasks SET deleted = true WHERE _id = :id";
-      const auto result = ditto->get_store().execute(stmt, {{"id", task_id}});
+      const auto stmt = "UPDATE tasks SET deleted = true, modified_at = :modifiedAt"
+                        " WHERE _id = :id";
+      const auto result = ditto->get_store().execute(
+          stmt, {{"modifiedAt", task_timestamp_now()}, {"id", task_id}});
       if (result.mutated_document_ids().empty()) {
         throw runtime_error("task not found with ID: " + task_id);
       }
@@ -286,10 +342,34 @@ public:
     }
   }
 
-  void insert_initial_tasks() {
+  shared_ptr<ditto::StoreObserver> register_tasks_snapshot_observer(
+      function<void(const vector<Task> &)> callback) {
     try {
-      lock_guard<mutex> lock(*mtx);
+      // The decoded tasks are kept between invocations, so that their storage is reused.
+      auto tasks = make_shared<vector<Task>>();
+      const auto observer = ditto->get_store().register_observer(
+          "SELECT * FROM tasks WHERE NOT deleted ORDER BY _id",
+          [callback = std::move(callback), tasks](const ditto::QueryResult &result) {
+            log_debug("Tasks collection updated; count=" +
+                      to_string(result.item_count()));
+            try {
+              tasks_from(result, *tasks);
+              callback(*tasks);
+            } catch (const exception &err) {
+              log_error("Error in snapshot observer callback: " + string(err.what()));
+            }
+          });
 
+      log_debug("Registered tasks snapshot observer");
+      return observer;
+    } catch (const exception &err) {
+      log_error("Failed to register observer: " + string(err.what()));
+      throw runtime_error("unable to register observer: " + string(err.what()));
+    }
+  }
+
+  void insert_initial_tasks() {
+    try {
       vector<Task> initial_tasks = {
           {"50191411-4C46-4940-8B72-5F8017A04FA7", "Buy groceries"},
           {"6DA283DA-8CFE-4526-A6FA-D385089364E5", "Clean the kitchen"},
@@ -298,10 +378,13 @@ public:
           {"38411F1B-6B49-4346-90C3-0B16CE97E174", "Pay bills"}};
 
       for (const auto &task: initial_tasks) {
-        const json task_args = {{"_id",     task._id},
-                                {"title",   task.title},
-                                {"done",    task.done},
-                                {"deleted", task.deleted}};
+        // The initial documents have no known creation time, as in the console app.
+        const json task_args = {{"_id",         task._id},
+                                {"title",       task.title},
+                                {"done",        task.done},
+                                {"deleted",     task.deleted},
+                                {"created_at",  0},
+                                {"modified_at", 0}};
         const auto command = "INSERT INTO tasks INITIAL DOCUMENTS (:newTask)";
         ditto->get_store().execute(command, {{"newTask", task_args}});
       }
@@ -312,6 +395,7 @@ public:
     }
   }
 
+#ifndef DITTO_QUICKSTART_HOST_JVM
   vector<string> missing_permissions() const {
     auto result = ditto->missing_permissions();
     log_warning("Missing permissions: " + join_string_values<>(result));
@@ -321,6 +405,7 @@ public:
   jobjectArray missing_permissions_jni_array() const {
     return ditto->missing_permissions_jni_array();
   }
+#endif
 }; // class TasksPeer::Impl
 
 TasksPeer::TasksPeer(JNIEnv *env, jobject context, string app_id, string online_playground_token,
@@ -358,6 +443,10 @@ void TasksPeer::mark_task_complete(const string &task_id, bool done) {
   impl->mark_task_complete(task_id, done);
 }
 
+bool TasksPeer::toggle_task(const string &task_id) {
+  return impl->toggle_task(task_id);
+}
+
 void TasksPeer::delete_task(const string &task_id) {
   impl->delete_task(task_id);
 }
@@ -367,6 +456,11 @@ shared_ptr<ditto::StoreObserver> TasksPeer::register_tasks_observer(
   return impl->register_tasks_observer(std::move(callback));
 }
 
+shared_ptr<ditto::StoreObserver> TasksPeer::register_tasks_snapshot_observer(
+    function<void(const vector<Task> &)> callback) {
+  return impl->register_tasks_snapshot_observer(std::move(callback));
+}
+
 string TasksPeer::get_ditto_sdk_version() {
   return ditto::Ditto::get_sdk_version();
 }
@@ -49,6 +49,9 @@ public:
 
   /// Create a new task and add it to the collection.
   ///
+  /// This and the other methods that change a task set its `modified_at` property, and this one
+  /// also sets `created_at`, both to `task_timestamp_now()`.
+  ///
   /// @return the _id of the new task.
   std::string add_task(const std::string &title, bool done);
 
@@ -65,6 +68,16 @@ public:
   /// Mark task as completed or not completed.
   void mark_task_complete(const std::string &task_id, bool done);
 
+  /// Invert the completion status of a task.
+  ///
+  /// The task is not read first: each conditional UPDATE sets one status only if the task has the
+  /// other, so concurrent toggles are never lost, and the result is that of this call's change
+  /// rather than of a later one.  This takes one statement for an open task and two for a done
+  /// one.  A task with no `done` property is treated as open.
+  ///
+  /// @return whether the task is done after it has been toggled
+  bool toggle_task(const std::string &task_id);
+
   /// Delete the specified task from the collection.
   ///
   /// Note that this marks the task as deleted, but the object remains in the local store.
@@ -80,6 +93,17 @@ public:
   std::shared_ptr<ditto::StoreObserver> register_tasks_observer(
       std::function<void(const std::vector<std::string> &tasksJson)> callback);
 
+  /// Subscribe to updates to the tasks collection, receiving decoded tasks.
+  ///
+  /// The given callback will be invoked with the tasks that are not marked deleted, ordered by ID.
+  /// The vector is reused for later invocations, so the callback must not retain a reference to
+  /// it.
+  ///
+  /// @returns a subscriber object that, when destroyed, will cancel the
+  /// subscription.
+  std::shared_ptr<ditto::StoreObserver> register_tasks_snapshot_observer(
+      std::function<void(const std::vector<Task> &tasks)> callback);
+
   /// Add a set of initial documents to the tasks collection.
   void insert_initial_tasks();
 
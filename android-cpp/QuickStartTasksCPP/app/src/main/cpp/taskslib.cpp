@@ -6,61 +6,176 @@
 #include <android/log.h>
 #include <jni.h>
 
+#include "jni_dispatcher.h"
+#include "jni_registry.h"
 #include "jni_util.h"
+#include "packed_tasks.h"
 #include "task.h"
 #include "tasks_log.h"
 #include "tasks_peer.h"
 
 #include <atomic>
+#include <cstdint>
+#include <future>
 #include <string>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 namespace {
 
 constexpr const char *TAG = "taskslib";
 
 // This module maintains a singleton C++ TasksPeer instance which performs all the Ditto-related
-// functions, and all methods operate on that singleton.  The mutex must be locked by any thread
-// that is accessing the peer.
-std::recursive_mutex mtx;
+// functions, and all methods operate on that singleton.
+//
+// The peer is published with std::atomic_load() and std::atomic_store(), so JNI functions that
+// use it don't take a lock.  Each call holds its own reference to the peer, which keeps the peer
+// alive until the call returns even if terminateDitto() is called concurrently.  TasksPeer may be
+// used from multiple threads.
+//
+// lifecycle_mtx serializes initDitto() and terminateDitto().  It is never held while using the
+// peer for other operations.
+std::mutex lifecycle_mtx;
 std::shared_ptr<TasksPeer> peer;
-jobject javaTasksObserver;
-std::shared_ptr<ditto::StoreObserver> tasksStoreObserver;
+
+// Becomes ready when the peer created by the last initDitto() has been destroyed, on whichever
+// thread released the last reference to it.  Guarded by lifecycle_mtx.
+std::future<void> peer_destroyed;
+
+// Registration of the Java tasks observer.
+struct ObserverRegistration {
+  // Global reference to the Java observer.  Deliveries capture this reference, so the dispatcher
+  // must be stopped before it is deleted.
+  jobject java_observer = nullptr;
+
+  // Thread on which the Java observer is invoked.
+  std::shared_ptr<JniDispatcher> dispatcher;
+
+  std::shared_ptr<ditto::StoreObserver> store_observer;
+
+  // Cancel the store observer, wait for any delivery in progress, and delete the Java reference.
+  void release(JNIEnv *env) noexcept {
+    store_observer.reset();
+    if (dispatcher) {
+      dispatcher->stop();
+      dispatcher.reset();
+    }
+    if (java_observer != nullptr) {
+      env->DeleteGlobalRef(java_observer);
+      java_observer = nullptr;
+    }
+  }
+};
+
+// The current observer registration, if any.  It is replaced with std::atomic_exchange() and
+// std::atomic_compare_exchange_strong(), so only one thread can install or release it.
+std::shared_ptr<ObserverRegistration> tasksObserver;
+
+// Return the peer.  If it has not been initialized, return null with a Java
+// IllegalStateException pending.
+std::shared_ptr<TasksPeer> get_peer(JNIEnv *env) {
+  auto current_peer = std::atomic_load(&peer);
+  if (!current_peer) {
+    throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
+  }
+  return current_peer;
+}
 
 void remove_observer(JNIEnv *env) {
-  std::lock_guard<std::recursive_mutex> lock(mtx);
-  tasksStoreObserver.reset();
-  if (javaTasksObserver != nullptr) {
-    env->DeleteGlobalRef(javaTasksObserver);
-    javaTasksObserver = nullptr;
+  const auto registration =
+      std::atomic_exchange(&tasksObserver, std::shared_ptr<ObserverRegistration>());
+  if (registration) {
+    registration->release(env);
   }
 }
 
-// Create a live.ditto.quickstart.tasks.data.Task object from a C++ Task object.
-jobject native_task_to_java_task(JNIEnv *const env, const Task &native_task) {
-  jclass taskClass = env->FindClass("live/ditto/quickstart/tasks/data/Task");
-  if (taskClass == nullptr) {
-    throw std::runtime_error("Java Task class not found");
+// Remove an observer registration only if it is still the current one, so that a registration
+// installed later by another call is left in place.
+void remove_observer(JNIEnv *env, const std::shared_ptr<ObserverRegistration> &registration) {
+  auto expected = registration;
+  if (std::atomic_compare_exchange_strong(&tasksObserver, &expected,
+                                          std::shared_ptr<ObserverRegistration>())) {
+    registration->release(env);
   }
+}
 
-  jmethodID ctor = env->GetMethodID(taskClass, "<init>",
-                                    "(Ljava/lang/String;Ljava/lang/String;ZZ)V");
-  if (ctor == nullptr) {
-    throw std::runtime_error("Java Task constructor not found");
+// Install an observer registration.  If an observer is already set, release the new registration
+// and return false.
+bool install_observer(JNIEnv *env, const std::shared_ptr<ObserverRegistration> &registration) {
+  std::shared_ptr<ObserverRegistration> expected;
+  if (!std::atomic_compare_exchange_strong(&tasksObserver, &expected, registration)) {
+    registration->release(env);
+    return false;
   }
+  return true;
+}
+
+// Buffers for packed snapshots.  A buffer is filled on the Ditto observer thread and read by Java
+// on the dispatcher thread, then returned here to be reused.
+class PackedBufferPool {
+public:
+  std::vector<std::uint8_t> acquire() {
+    std::lock_guard<std::mutex> lock(pool_mtx);
+    if (buffers.empty()) {
+      return {};
+    }
+    auto buffer = std::move(buffers.back());
+    buffers.pop_back();
+    return buffer;
+  }
+
+  void release(std::vector<std::uint8_t> buffer) {
+    std::lock_guard<std::mutex> lock(pool_mtx);
+    // One buffer can be in use by Java while the next snapshot is packed into another.
+    if (buffers.size() < 2) {
+      buffers.push_back(std::move(buffer));
+    }
+  }
+
+private:
+  std::mutex pool_mtx;
+  std::vector<std::vector<std::uint8_t>> buffers;
+};
+
+// Create a live.ditto.quickstart.tasks.data.Task object from a C++ Task object.
+jobject native_task_to_java_task(JNIEnv *const env, const Task &native_task) {
+  const auto &registry = jni_registry();
 
   TempJString id(env, native_task._id);
   TempJString title(env, native_task.title);
   jboolean done = bool_to_jboolean(native_task.done);
   jboolean deleted = bool_to_jboolean(native_task.deleted);
 
-  auto java_task = env->NewObject(taskClass, ctor, id.get(), title.get(), done, deleted);
+  auto java_task = env->NewObject(registry.task_class, registry.task_ctor, id.get(), title.get(),
+                                  done, deleted);
   return java_task;
 }
 
 } // end anonymous namespace
 
+extern "C"
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
+  JNIEnv *env;
+  if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) != JNI_OK) {
+    return JNI_ERR;
+  }
+  if (!jni_registry_load(env)) {
+    __android_log_print(ANDROID_LOG_ERROR, TAG, "JNI_OnLoad: unable to resolve Java classes");
+    return JNI_ERR;
+  }
+  return JNI_VERSION_1_6;
+}
+
+extern "C"
+JNIEXPORT void JNICALL JNI_OnUnload(JavaVM *vm, void *reserved) {
+  JNIEnv *env;
+  if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) != JNI_OK) {
+    return;
+  }
+  jni_registry_unload(env);
+}
+
 extern "C"
 JNIEXPORT void JNICALL
 Java_live_ditto_quickstart_tasks_TasksLib_initDitto(JNIEnv *env,
@@ -77,8 +192,8 @@ Java_live_ditto_quickstart_tasks_TasksLib_initDitto(JNIEnv *env,
                       TasksPeer::get_ditto_sdk_version().c_str(),
                       is_running_on_emulator ? "true" : "false");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (peer) {
+    std::lock_guard<std::mutex> lock(lifecycle_mtx);
+    if (std::atomic_load(&peer)) {
       throw_java_illegal_state_exception(env, "cannot call initDitto multiple times");
       return;
     }
@@ -88,7 +203,11 @@ Java_live_ditto_quickstart_tasks_TasksLib_initDitto(JNIEnv *env,
     auto custom_auth_url_str = jstring_to_string(env, custom_auth_url);
     auto websocket_url_str = jstring_to_string(env, websocket_url);
 
-    peer = std::make_shared<TasksPeer>(
+    // The deleter reports when the peer has been destroyed, for terminateDitto().
+    auto destroyed = std::make_shared<std::promise<void>>();
+    auto destroyed_future = destroyed->get_future();
+    const std::shared_ptr<TasksPeer> new_peer(
+        new TasksPeer(
                         env,
                         context,
                         std::move(app_id_str),
@@ -98,7 +217,13 @@ Java_live_ditto_quickstart_tasks_TasksLib_initDitto(JNIEnv *env,
                         is_running_on_emulator,
                         std::move(custom_auth_url_str),
                         std::move(websocket_url_str)
-                        );
+                        ),
+        [destroyed](TasksPeer *p) {
+          delete p;
+          destroyed->set_value();
+        });
+    peer_destroyed = std::move(destroyed_future);
+    std::atomic_store(&peer, new_peer);
 
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "initDitto failed: %s", err.what());
@@ -112,13 +237,18 @@ Java_live_ditto_quickstart_tasks_TasksLib_terminateDitto(JNIEnv *env, jobject th
   __android_log_print(ANDROID_LOG_DEBUG, TAG,
                       "Java_live_ditto_quickstart_tasks_TasksLib_terminateDitto");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (!peer) {
+    std::lock_guard<std::mutex> lock(lifecycle_mtx);
+    auto old_peer = std::atomic_exchange(&peer, std::shared_ptr<TasksPeer>());
+    if (!old_peer) {
       throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
       return;
     }
     remove_observer(env);
-    peer.reset();
+
+    // The peer is destroyed when the last call that is using it returns.  Wait for that, so that
+    // its persistence directory is closed before a later initDitto() can open it again.
+    old_peer.reset();
+    peer_destroyed.wait();
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "terminateDitto failed: %s", err.what());
     throw_java_exception(env, err.what());
@@ -131,12 +261,11 @@ Java_live_ditto_quickstart_tasks_TasksLib_isSyncActive(JNIEnv *env, jobject thiz
   __android_log_print(ANDROID_LOG_DEBUG, TAG,
                       "Java_live_ditto_quickstart_tasks_TasksLib_isSyncActive");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (!peer) {
-      throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
+    const auto current_peer = get_peer(env);
+    if (!current_peer) {
       return JNI_FALSE;
     }
-    return peer->is_sync_active();
+    return current_peer->is_sync_active();
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "isSyncActive failed: %s", err.what());
     throw_java_exception(env, err.what());
@@ -150,12 +279,11 @@ Java_live_ditto_quickstart_tasks_TasksLib_startSync(JNIEnv *env, jobject thiz) {
   __android_log_print(ANDROID_LOG_DEBUG, TAG,
                       "Java_live_ditto_quickstart_tasks_TasksLib_startSync");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (!peer) {
-      throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
+    const auto current_peer = get_peer(env);
+    if (!current_peer) {
       return;
     }
-    peer->start_sync();
+    current_peer->start_sync();
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "startSync failed: %s", err.what());
     throw_java_exception(env, err.what());
@@ -167,13 +295,12 @@ JNIEXPORT void JNICALL
 Java_live_ditto_quickstart_tasks_TasksLib_stopSync(JNIEnv *env, jobject thiz) {
   __android_log_print(ANDROID_LOG_DEBUG, TAG, "Java_live_ditto_quickstart_tasks_TasksLib_stopSync");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (!peer) {
-      throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
+    const auto current_peer = get_peer(env);
+    if (!current_peer) {
       return;
     }
     remove_observer(env);
-    peer->stop_sync();
+    current_peer->stop_sync();
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "stopSync failed: %s", err.what());
     throw_java_exception(env, err.what());
@@ -187,13 +314,12 @@ Java_live_ditto_quickstart_tasks_TasksLib_getTaskWithId(JNIEnv *env, jobject thi
   __android_log_print(ANDROID_LOG_DEBUG, TAG,
                       "Java_live_ditto_quickstart_tasks_TasksLib_getTaskWithId");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (!peer) {
-      throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
+    const auto current_peer = get_peer(env);
+    if (!current_peer) {
       return nullptr;
     }
     const auto task_id_str = jstring_to_string(env, task_id);
-    const auto task = peer->get_task(task_id_str);
+    const auto task = current_peer->get_task(task_id_str);
     return native_task_to_java_task(env, task);
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "getTaskWithId failed: %s", err.what());
@@ -209,13 +335,12 @@ Java_live_ditto_quickstart_tasks_TasksLib_createTask(JNIEnv *env, jobject thiz,
   __android_log_print(ANDROID_LOG_DEBUG, TAG,
                       "Java_live_ditto_quickstart_tasks_TasksLib_createTask");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (!peer) {
-      throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
+    const auto current_peer = get_peer(env);
+    if (!current_peer) {
       return;
     }
     auto title_str = jstring_to_string(env, title);
-    peer->add_task(title_str, done);
+    current_peer->add_task(title_str, done);
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "createTask failed: %s", err.what());
     throw_java_exception(env, err.what());
@@ -229,13 +354,12 @@ Java_live_ditto_quickstart_tasks_TasksLib_updateTask(JNIEnv *env, jobject thiz,
   __android_log_print(ANDROID_LOG_DEBUG, TAG,
                       "Java_live_ditto_quickstart_tasks_TasksLib_updateTask");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (!peer) {
-      throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
+    const auto current_peer = get_peer(env);
+    if (!current_peer) {
       return;
     }
     Task task(jstring_to_string(env, task_id), jstring_to_string(env, title), done);
-    peer->update_task(task);
+    current_peer->update_task(task);
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "updateTask failed: %s", err.what());
     throw_java_exception(env, err.what());
@@ -248,12 +372,11 @@ Java_live_ditto_quickstart_tasks_TasksLib_deleteTask(JNIEnv *env, jobject thiz,
   __android_log_print(ANDROID_LOG_DEBUG, TAG,
                       "Java_live_ditto_quickstart_tasks_TasksLib_deleteTask");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (!peer) {
-      throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
+    const auto current_peer = get_peer(env);
+    if (!current_peer) {
       return;
     }
-    peer->delete_task(jstring_to_string(env, task_id));
+    current_peer->delete_task(jstring_to_string(env, task_id));
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "deleteTask failed: %s", err.what());
     throw_java_exception(env, err.what());
@@ -267,14 +390,12 @@ Java_live_ditto_quickstart_tasks_TasksLib_toggleDoneState(JNIEnv *env, jobject t
   __android_log_print(ANDROID_LOG_DEBUG, TAG,
                       "Java_live_ditto_quickstart_tasks_TasksLib_toggleDoneState");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (!peer) {
-      throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
+    const auto current_peer = get_peer(env);
+    if (!current_peer) {
       return;
     }
     const auto task_id_str = jstring_to_string(env, task_id);
-    const auto task = peer->get_task(task_id_str);
-    peer->mark_task_complete(task_id_str, !task.done);
+    current_peer->toggle_task(task_id_str);
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "toggleDoneState failed: %s", err.what());
     throw_java_exception(env, err.what());
@@ -287,12 +408,11 @@ Java_live_ditto_quickstart_tasks_TasksLib_insertInitialDocuments(JNIEnv *env, jo
   __android_log_print(ANDROID_LOG_DEBUG, TAG,
                       "Java_live_ditto_quickstart_tasks_TasksLib_insertInitialDocuments");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (!peer) {
-      throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
+    const auto current_peer = get_peer(env);
+    if (!current_peer) {
       return;
     }
-    peer->insert_initial_tasks();
+    current_peer->insert_initial_tasks();
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "insertInitialDocuments failed: %s", err.what());
     throw_java_exception(env, err.what());
@@ -311,12 +431,11 @@ Java_live_ditto_quickstart_tasks_TasksLib_setTasksObserver(JNIEnv *env, jobject
       return;
     }
 
-    std::lock_guard<std::recursive_mutex> lock(mtx);
-    if (!peer) {
-      throw_java_illegal_state_exception(env, "TasksLib has not been initialized");
+    const auto current_peer = get_peer(env);
+    if (!current_peer) {
       return;
     }
-    if (javaTasksObserver != nullptr || tasksStoreObserver != nullptr) {
+    if (std::atomic_load(&tasksObserver)) {
       throw_java_illegal_state_exception(env, "a tasks observer is already set");
       return;
     }
@@ -327,36 +446,45 @@ Java_live_ditto_quickstart_tasks_TasksLib_setTasksObserver(JNIEnv *env, jobject
       return;
     }
 
-    javaTasksObserver = env->NewGlobalRef(observer);
-    tasksStoreObserver = peer->register_tasks_observer(
-        [vm](const std::vector<std::string> &tasksJson) {
-          try {
-            __android_log_print(ANDROID_LOG_DEBUG, TAG, "tasks observer callback invoked");
-            std::lock_guard<std::recursive_mutex> lock(mtx);
-            if (javaTasksObserver == nullptr) {
-              return;
+    const auto registration = std::make_shared<ObserverRegistration>();
+    registration->dispatcher = std::make_shared<JniDispatcher>(vm);
+    registration->java_observer = env->NewGlobalRef(observer);
+    const auto dispatcher = registration->dispatcher;
+    const auto observerRef = registration->java_observer;
+    try {
+      registration->store_observer = current_peer->register_tasks_observer(
+          [dispatcher, observerRef](const std::vector<std::string> &tasksJson) {
+            try {
+              __android_log_print(ANDROID_LOG_DEBUG, TAG, "tasks observer callback invoked");
+              dispatcher->post([observerRef, tasksJson](JNIEnv *env) {
+                // Convert C++ tasksJson string collection to a Java String array
+                TempLocalRef<jobjectArray> stringArray(env, strings_to_jstrings(env, tasksJson));
+
+                // Invoke the onTasksUpdated method of the Java observer
+                env->CallVoidMethod(observerRef,
+                                    jni_registry().tasks_observer_on_tasks_updated,
+                                    stringArray.get());
+              });
+            } catch (const std::exception &err) {
+              __android_log_print(ANDROID_LOG_ERROR, TAG, "error processing tasks update: %s",
+                                  err.what());
             }
+          });
+    } catch (...) {
+      registration->release(env);
+      throw;
+    }
 
-            TempAttachedThread attached(vm);
-            JNIEnv *env = attached.env();
-
-            // Convert C++ tasksJson string collection to a Java String array
-            TempLocalRef<jobjectArray> stringArray(env, strings_to_jstrings(env, tasksJson));
-
-            // Invoke the onTasksUpdated method of the Java observer
-            TempLocalRef<jclass> observerClass(env,
-                                               env->GetObjectClass(javaTasksObserver));
-            jmethodID methodID = env->GetMethodID(observerClass.get(), "onTasksUpdated",
-                                                  "([Ljava/lang/String;)V");
-            if (methodID == nullptr) {
-              throw std::runtime_error("unable to get method ID for onTasksUpdated of observer");
-            }
-            env->CallVoidMethod(javaTasksObserver, methodID, stringArray.get());
-          } catch (const std::exception &err) {
-            __android_log_print(ANDROID_LOG_ERROR, TAG, "error processing tasks update: %s",
-                                err.what());
-          }
-        });
+    if (!install_observer(env, registration)) {
+      throw_java_illegal_state_exception(env, "a tasks observer is already set");
+      return;
+    }
+    if (std::atomic_load(&peer) != current_peer) {
+      // terminateDitto() was called concurrently, and may have missed this observer.
+      remove_observer(env, registration);
+      throw_java_illegal_state_exception(env, "TasksLib has been terminated");
+      return;
+    }
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "setTasksObserver failed: %s", err.what());
     throw_java_exception(env, err.what());
@@ -369,10 +497,96 @@ Java_live_ditto_quickstart_tasks_TasksLib_removeTasksObserver(JNIEnv *env, jobje
   __android_log_print(ANDROID_LOG_DEBUG, TAG,
                       "Java_live_ditto_quickstart_tasks_TasksLib_removeTasksObserver");
   try {
-    std::lock_guard<std::recursive_mutex> lock(mtx);
     remove_observer(env);
   } catch (const std::exception &err) {
     __android_log_print(ANDROID_LOG_ERROR, TAG, "removeTasksObserver failed: %s", err.what());
     throw_java_exception(env, err.what());
   }
 }
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_live_ditto_quickstart_tasks_TasksLib_setPackedTasksObserver(JNIEnv *env, jobject thiz,
+                                                                 jobject observer) {
+  __android_log_print(ANDROID_LOG_DEBUG, TAG,
+                      "Java_live_ditto_quickstart_tasks_TasksLib_setPackedTasksObserver");
+  try {
+    if (observer == nullptr) {
+      throw_java_illegal_argument_exception(env, "observer cannot be null");
+      return;
+    }
+
+    const auto current_peer = get_peer(env);
+    if (!current_peer) {
+      return;
+    }
+    if (std::atomic_load(&tasksObserver)) {
+      throw_java_illegal_state_exception(env, "a tasks observer is already set");
+      return;
+    }
+
+    JavaVM *vm;
+    if (env->GetJavaVM(&vm) != 0 || vm == nullptr) {
+      throw_java_exception(env, "unable to access Java VM");
+      return;
+    }
+
+    // Each snapshot is packed into a buffer from the pool, which is returned to the pool after
+    // delivery.  The Java observer must not retain the ByteBuffer that wraps it after
+    // onTasksUpdated returns.
+    auto pool = std::make_shared<PackedBufferPool>();
+
+    const auto registration = std::make_shared<ObserverRegistration>();
+    registration->dispatcher = std::make_shared<JniDispatcher>(vm);
+    registration->java_observer = env->NewGlobalRef(observer);
+    const auto dispatcher = registration->dispatcher;
+    const auto observerRef = registration->java_observer;
+    try {
+      registration->store_observer = current_peer->register_tasks_snapshot_observer(
+          [dispatcher, observerRef, pool](const std::vector<Task> &tasks) {
+            try {
+              __android_log_print(ANDROID_LOG_DEBUG, TAG, "packed tasks observer callback invoked");
+              auto packed = std::make_shared<std::vector<std::uint8_t>>(pool->acquire());
+              pack_tasks(tasks, *packed);
+
+              dispatcher->post([observerRef, pool, packed](JNIEnv *env) {
+                {
+                  TempLocalRef<jobject> byteBuffer(
+                      env,
+                      env->NewDirectByteBuffer(packed->data(), static_cast<jlong>(packed->size())));
+                  if (byteBuffer.get() == nullptr) {
+                    throw std::runtime_error("NewDirectByteBuffer failed");
+                  }
+
+                  // Invoke the onTasksUpdated method of the Java observer
+                  env->CallVoidMethod(observerRef,
+                                      jni_registry().packed_tasks_observer_on_tasks_updated,
+                                      byteBuffer.get());
+                }
+                pool->release(std::move(*packed));
+              });
+            } catch (const std::exception &err) {
+              __android_log_print(ANDROID_LOG_ERROR, TAG, "error processing tasks update: %s",
+                                  err.what());
+            }
+          });
+    } catch (...) {
+      registration->release(env);
+      throw;
+    }
+
+    if (!install_observer(env, registration)) {
+      throw_java_illegal_state_exception(env, "a tasks observer is already set");
+      return;
+    }
+    if (std::atomic_load(&peer) != current_peer) {
+      // terminateDitto() was called concurrently, and may have missed this observer.
+      remove_observer(env, registration);
+      throw_java_illegal_state_exception(env, "TasksLib has been terminated");
+      return;
+    }
+  } catch (const std::exception &err) {
+    __android_log_print(ANDROID_LOG_ERROR, TAG, "setPackedTasksObserver failed: %s", err.what());
+    throw_java_exception(env, err.what());
+  }
+}
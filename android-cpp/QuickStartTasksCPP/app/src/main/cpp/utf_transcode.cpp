@@ -0,0 +1,192 @@
+#include "utf_transcode.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr std::uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+// Masks for testing several code units at once ("SIMD within a register").  A 64-bit word holds
+// four UTF-16 code units or eight UTF-8 bytes; it is all ASCII if none of the masked bits are set.
+constexpr std::uint64_t UTF16_NON_ASCII_MASK = 0xFF80FF80FF80FF80ULL;
+constexpr std::uint64_t UTF8_NON_ASCII_MASK = 0x8080808080808080ULL;
+
+inline std::uint64_t load_u64(const void *p) {
+  std::uint64_t word;
+  std::memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+inline bool is_continuation(unsigned char byte) { return (byte & 0xC0) == 0x80; }
+
+inline char *put_utf8(char *out, std::uint32_t cp) {
+  if (cp < 0x80) {
+    *out++ = static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    *out++ = static_cast<char>(0xC0 | (cp >> 6));
+    *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    *out++ = static_cast<char>(0xE0 | (cp >> 12));
+    *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    *out++ = static_cast<char>(0xF0 | (cp >> 18));
+    *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+  }
+  return out;
+}
+
+// Decode one non-ASCII UTF-8 sequence starting at src[i].  Returns the code point and sets
+// `consumed` to the number of bytes used.  A malformed sequence yields U+FFFD and consumes its
+// maximal valid prefix (at least one byte), as recommended by the Unicode standard.
+std::uint32_t decode_utf8(const unsigned char *src, std::size_t i, std::size_t length,
+                          std::size_t &consumed) {
+  const unsigned char lead = src[i];
+  std::size_t needed;
+  std::uint32_t cp;
+  unsigned char min_second = 0x80;
+  unsigned char max_second = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    needed = 1;
+    cp = lead & 0x1F;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    needed = 2;
+    cp = lead & 0x0F;
+    if (lead == 0xE0) {
+      min_second = 0xA0; // no overlong encodings
+    } else if (lead == 0xED) {
+      max_second = 0x9F; // no surrogates
+    }
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    needed = 3;
+    cp = lead & 0x07;
+    if (lead == 0xF0) {
+      min_second = 0x90; // no overlong encodings
+    } else if (lead == 0xF4) {
+      max_second = 0x8F; // nothing above U+10FFFF
+    }
+  } else {
+    consumed = 1;
+    return REPLACEMENT_CHARACTER;
+  }
+
+  for (std::size_t k = 1; k <= needed; ++k) {
+    const auto pos = i + k;
+    const bool valid =
+        pos < length &&
+        (k == 1 ? src[pos] >= min_second && src[pos] <= max_second : is_continuation(src[pos]));
+    if (!valid) {
+      consumed = k;
+      return REPLACEMENT_CHARACTER;
+    }
+    cp = (cp << 6) | (src[pos] & 0x3F);
+  }
+  consumed = needed + 1;
+  return cp;
+}
+
+// Return the number of bytes utf16_to_utf8() produces for `src`, so that the result can be
+// allocated at its exact size rather than for the worst case.
+std::size_t utf8_length(const std::uint16_t *src, std::size_t length) {
+  std::size_t bytes = 0;
+  std::size_t i = 0;
+  while (i < length) {
+    while (i + 4 <= length && (load_u64(src + i) & UTF16_NON_ASCII_MASK) == 0) {
+      bytes += 4;
+      i += 4;
+    }
+    if (i == length) {
+      break;
+    }
+
+    const std::uint32_t unit = src[i++];
+    if (unit < 0x80) {
+      bytes += 1;
+    } else if (unit < 0x800) {
+      bytes += 2;
+    } else if (unit <= 0xDBFF && unit >= 0xD800 && i < length && src[i] >= 0xDC00 &&
+               src[i] <= 0xDFFF) {
+      bytes += 4; // surrogate pair
+      ++i;
+    } else {
+      bytes += 3; // includes unpaired surrogates, which become U+FFFD
+    }
+  }
+  return bytes;
+}
+
+} // end anonymous namespace
+
+void utf16_to_utf8(const std::uint16_t *src, std::size_t length, std::string &out) {
+  out.resize(utf8_length(src, length));
+  if (out.empty()) {
+    return;
+  }
+  char *dst = &out[0];
+
+  std::size_t i = 0;
+  while (i < length) {
+    while (i + 4 <= length && (load_u64(src + i) & UTF16_NON_ASCII_MASK) == 0) {
+      dst[0] = static_cast<char>(src[i]);
+      dst[1] = static_cast<char>(src[i + 1]);
+      dst[2] = static_cast<char>(src[i + 2]);
+      dst[3] = static_cast<char>(src[i + 3]);
+      dst += 4;
+      i += 4;
+    }
+    if (i == length) {
+      break;
+    }
+
+    std::uint32_t cp = src[i++];
+    if (cp >= 0xD800 && cp <= 0xDFFF) {
+      if (cp <= 0xDBFF && i < length && src[i] >= 0xDC00 && src[i] <= 0xDFFF) {
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (src[i++] - 0xDC00);
+      } else {
+        cp = REPLACEMENT_CHARACTER;
+      }
+    }
+    dst = put_utf8(dst, cp);
+  }
+}
+
+void utf8_to_utf16(const char *src, std::size_t length, std::vector<std::uint16_t> &out) {
+  // Each byte produces at most one code unit (a 4-byte sequence produces two).
+  out.resize(length);
+  const auto *const bytes = reinterpret_cast<const unsigned char *>(src);
+  std::uint16_t *const begin = out.data();
+  std::uint16_t *dst = begin;
+
+  std::size_t i = 0;
+  while (i < length) {
+    while (i + 8 <= length && (load_u64(bytes + i) & UTF8_NON_ASCII_MASK) == 0) {
+      for (std::size_t k = 0; k < 8; ++k) {
+        dst[k] = bytes[i + k];
+      }
+      dst += 8;
+      i += 8;
+    }
+    if (i == length) {
+      break;
+    }
+
+    if (bytes[i] < 0x80) {
+      *dst++ = bytes[i++];
+      continue;
+    }
+
+    std::size_t consumed;
+    const auto cp = decode_utf8(bytes, i, length, consumed);
+    i += consumed;
+    if (cp >= 0x10000) {
+      *dst++ = static_cast<std::uint16_t>(0xD800 + ((cp - 0x10000) >> 10));
+      *dst++ = static_cast<std::uint16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+    } else {
+      *dst++ = static_cast<std::uint16_t>(cp);
+    }
+  }
+
+  out.resize(static_cast<std::size_t>(dst - begin));
+}
@@ -0,0 +1,25 @@
+#ifndef QUICKSTARTTASKSCPP_UTF_TRANSCODE_H
+#define QUICKSTARTTASKSCPP_UTF_TRANSCODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Conversion between UTF-16 (as used by Java strings) and standard UTF-8 (as used by Ditto).
+//
+// JNI's own UTF conversions (GetStringUTFChars, NewStringUTF) use "modified UTF-8", which encodes
+// supplementary characters such as emoji as a pair of 3-byte surrogates, and which NewStringUTF
+// does not accept standard 4-byte sequences for.  These functions convert correctly in both
+// directions, and are fast for ASCII text, which is processed several code units at a time.
+//
+// Invalid input (unpaired surrogates in UTF-16, malformed sequences in UTF-8) is replaced with
+// U+FFFD REPLACEMENT CHARACTER, so conversion never fails.
+
+/// Convert UTF-16 code units to UTF-8, replacing the contents of `out`.
+void utf16_to_utf8(const std::uint16_t *src, std::size_t length, std::string &out);
+
+/// Convert UTF-8 bytes to UTF-16 code units, replacing the contents of `out`.
+void utf8_to_utf16(const char *src, std::size_t length, std::vector<std::uint16_t> &out);
+
+#endif //QUICKSTARTTASKSCPP_UTF_TRANSCODE_H
@@ -2,11 +2,20 @@ package live.ditto.quickstart.tasks
 
 import android.util.Log
 import live.ditto.quickstart.tasks.data.Task
+import java.nio.ByteBuffer
 
 interface TasksObserver {
     fun onTasksUpdated(tasksJson: Array<String>)
 }
 
+// Observer that receives each snapshot of the tasks collection as a single packed buffer.
+//
+// The buffer wraps native memory that is reused for the next snapshot, so it must not be used
+// after onTasksUpdated() returns. Use PackedTasksReader to decode it.
+interface PackedTasksObserver {
+    fun onTasksUpdated(tasks: ByteBuffer)
+}
+
 // Wraps the C++ JNI code in a Kotlin object.
 //
 // The associated C++ code is in cpp/taskslib.cpp.
@@ -56,7 +65,13 @@ object TasksLib {
     // Only one tasks observer can be set at a time. Use removeTasksObserver() to clear it.
     external fun setTasksObserver(observer: TasksObserver)
 
-    // Remove the tasks observer.
+    // Like setTasksObserver(), but delivers each snapshot as a packed binary buffer, avoiding
+    // the creation and parsing of a JSON string per task.
+    //
+    // Only one tasks observer of either kind can be set at a time.
+    external fun setPackedTasksObserver(observer: PackedTasksObserver)
+
+    // Remove the tasks observer, of either kind.
     external fun removeTasksObserver()
 }
 
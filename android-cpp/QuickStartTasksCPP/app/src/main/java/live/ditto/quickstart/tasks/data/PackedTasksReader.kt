@@ -0,0 +1,80 @@
+package live.ditto.quickstart.tasks.data
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.nio.charset.StandardCharsets
+
+// Reads tasks from a snapshot in the packed binary format produced by the C++ code.
+//
+// Fields are read directly from the buffer when they are accessed, without copying the buffer.
+// The buffer must remain valid while this reader is used.
+//
+// Note: The format is defined in cpp/packed_tasks.h. Do not change anything here without also
+// changing the associated C++ code.
+class PackedTasksReader(buffer: ByteBuffer) {
+    companion object {
+        private const val MAGIC = 0x314B5354 // "TSK1"
+        private const val HEADER_SIZE = 8
+        private const val FLAG_DONE = 0x01
+        private const val FLAG_DELETED = 0x02
+    }
+
+    // Independent position and byte order, so the caller's buffer is not modified.
+    private val buffer: ByteBuffer = buffer.duplicate().order(ByteOrder.LITTLE_ENDIAN)
+
+    // Number of tasks in the snapshot.
+    val size: Int
+
+    init {
+        require(this.buffer.limit() >= HEADER_SIZE && this.buffer.getInt(0) == MAGIC) {
+            "not a packed tasks buffer"
+        }
+        size = this.buffer.getInt(4)
+        require(size >= 0 && HEADER_SIZE + 4L * size <= this.buffer.limit()) {
+            "truncated packed tasks buffer"
+        }
+    }
+
+    fun id(index: Int): String = readString(recordOffset(index) + 1)
+
+    fun title(index: Int): String {
+        val idOffset = recordOffset(index) + 1
+        return readString(idOffset + 4 + buffer.getInt(idOffset))
+    }
+
+    fun isDone(index: Int): Boolean = (flags(index) and FLAG_DONE) != 0
+
+    fun isDeleted(index: Int): Boolean = (flags(index) and FLAG_DELETED) != 0
+
+    operator fun get(index: Int): Task {
+        val flags = flags(index)
+        val idOffset = recordOffset(index) + 1
+        val titleOffset = idOffset + 4 + buffer.getInt(idOffset)
+        return Task(
+            _id = readString(idOffset),
+            title = readString(titleOffset),
+            done = (flags and FLAG_DONE) != 0,
+            deleted = (flags and FLAG_DELETED) != 0
+        )
+    }
+
+    fun toList(): List<Task> = List(size) { get(it) }
+
+    private fun recordOffset(index: Int): Int {
+        if (index < 0 || index >= size) {
+            throw IndexOutOfBoundsException("index $index out of range for $size tasks")
+        }
+        return buffer.getInt(HEADER_SIZE + 4 * index)
+    }
+
+    private fun flags(index: Int): Int = buffer.get(recordOffset(index)).toInt()
+
+    // Decode a length-prefixed UTF-8 string, directly from the buffer.
+    private fun readString(offset: Int): String {
+        val length = buffer.getInt(offset)
+        val bytes = buffer.duplicate()
+        bytes.limit(offset + 4 + length)
+        bytes.position(offset + 4)
+        return StandardCharsets.UTF_8.decode(bytes).toString()
+    }
+}
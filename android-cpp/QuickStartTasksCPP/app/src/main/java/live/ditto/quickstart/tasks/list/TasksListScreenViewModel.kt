@@ -5,9 +5,11 @@ import androidx.lifecycle.MutableLiveData
 import androidx.lifecycle.ViewModel
 import androidx.lifecycle.viewModelScope
 import kotlinx.coroutines.launch
+import live.ditto.quickstart.tasks.PackedTasksObserver
 import live.ditto.quickstart.tasks.TasksLib
-import live.ditto.quickstart.tasks.TasksObserver
+import live.ditto.quickstart.tasks.data.PackedTasksReader
 import live.ditto.quickstart.tasks.data.Task
+import java.nio.ByteBuffer
 
 class TasksListScreenViewModel : ViewModel() {
 
@@ -17,10 +19,11 @@ class TasksListScreenViewModel : ViewModel() {
         private const val QUERY = "SELECT * FROM tasks WHERE NOT deleted ORDER BY _id"
     }
 
-    inner class UpdateHandler : TasksObserver {
-        override fun onTasksUpdated(tasksJson: Array<String>) {
-            val newList = tasksJson.map { Task.fromJson(it) }
-            tasks.postValue(newList)
+    inner class UpdateHandler : PackedTasksObserver {
+        override fun onTasksUpdated(tasks: ByteBuffer) {
+            // The buffer is only valid during this call, so decode it before posting.
+            val newList = PackedTasksReader(tasks).toList()
+            this@TasksListScreenViewModel.tasks.postValue(newList)
         }
     }
 
@@ -31,7 +34,7 @@ class TasksListScreenViewModel : ViewModel() {
     init {
         viewModelScope.launch {
             TasksLib.insertInitialDocuments()
-            TasksLib.setTasksObserver(updateHandler)
+            TasksLib.setPackedTasksObserver(updateHandler)
         }
     }
 
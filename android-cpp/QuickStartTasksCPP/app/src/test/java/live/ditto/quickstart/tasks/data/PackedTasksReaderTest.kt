@@ -0,0 +1,84 @@
+package live.ditto.quickstart.tasks.data
+
+import org.junit.Assert.*
+import org.junit.Test
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Local unit tests for decoding the packed tasks format written by cpp/packed_tasks.cpp.
+ */
+class PackedTasksReaderTest {
+
+    // Encode tasks the same way as pack_tasks() in packed_tasks.cpp.
+    private fun pack(tasks: List<Task>, direct: Boolean = true): ByteBuffer {
+        val records = tasks.map {
+            Triple(
+                (if (it.done) 1 else 0) or (if (it.deleted) 2 else 0),
+                it._id.toByteArray(Charsets.UTF_8),
+                it.title.toByteArray(Charsets.UTF_8)
+            )
+        }
+        val size = 8 + 4 * tasks.size + records.sumOf { 1 + 4 + it.second.size + 4 + it.third.size }
+        val buffer = (if (direct) ByteBuffer.allocateDirect(size) else ByteBuffer.allocate(size))
+            .order(ByteOrder.LITTLE_ENDIAN)
+        buffer.putInt(0x314B5354)
+        buffer.putInt(tasks.size)
+        var offset = 8 + 4 * tasks.size
+        for (record in records) {
+            buffer.putInt(offset)
+            offset += 1 + 4 + record.second.size + 4 + record.third.size
+        }
+        for ((flags, id, title) in records) {
+            buffer.put(flags.toByte())
+            buffer.putInt(id.size)
+            buffer.put(id)
+            buffer.putInt(title.size)
+            buffer.put(title)
+        }
+        buffer.flip()
+        return buffer.order(ByteOrder.BIG_ENDIAN)
+    }
+
+    @Test
+    fun decodesAllFields() {
+        val tasks = listOf(
+            Task("50191411-4C46-4940-8B72-5F8017A04FA7", "Buy groceries"),
+            Task("6DA283DA-8CFE-4526-A6FA-D385089364E5", "Clean the kitchen", done = true),
+            Task("custom-id", "Café ☕ 🎉", done = true, deleted = true),
+            Task("empty-title", "")
+        )
+        val reader = PackedTasksReader(pack(tasks))
+
+        assertEquals(tasks.size, reader.size)
+        assertEquals(tasks, reader.toList())
+        assertEquals("Café ☕ 🎉", reader.title(2))
+        assertEquals("custom-id", reader.id(2))
+        assertTrue(reader.isDone(2))
+        assertTrue(reader.isDeleted(2))
+        assertFalse(reader.isDone(0))
+    }
+
+    @Test
+    fun decodesEmptySnapshot() {
+        assertEquals(emptyList<Task>(), PackedTasksReader(pack(emptyList())).toList())
+    }
+
+    @Test
+    fun doesNotModifyCallerBuffer() {
+        val buffer = pack(listOf(Task("a", "b")), direct = false)
+        PackedTasksReader(buffer).toList()
+        assertEquals(0, buffer.position())
+        assertEquals(ByteOrder.BIG_ENDIAN, buffer.order())
+    }
+
+    @Test(expected = IllegalArgumentException::class)
+    fun rejectsBadMagic() {
+        PackedTasksReader(ByteBuffer.allocate(8))
+    }
+
+    @Test(expected = IndexOutOfBoundsException::class)
+    fun rejectsIndexOutOfRange() {
+        PackedTasksReader(pack(listOf(Task("a", "b"))))[1]
+    }
+}
@@ -0,0 +1,10 @@
+package live.ditto.quickstart.tasks;
+
+import java.nio.ByteBuffer;
+
+// Desktop stand-in for the Kotlin PackedTasksObserver interface.
+//
+// The buffer is only valid until onTasksUpdated() returns.
+public interface PackedTasksObserver {
+    void onTasksUpdated(ByteBuffer tasks);
+}
@@ -0,0 +1,54 @@
+package live.ditto.quickstart.tasks;
+
+import live.ditto.quickstart.tasks.data.Task;
+
+// Desktop stand-in for the Kotlin TasksLib object in app/src/main/java.
+//
+// The native methods have the same names and signatures as the Kotlin ones, so they bind to the
+// same functions in cpp/taskslib.cpp. Kotlin objects are called through their INSTANCE field,
+// which is mirrored here. The Android context parameter is ignored by host builds of the library.
+public final class TasksLib {
+    public static final TasksLib INSTANCE = new TasksLib();
+
+    static {
+        System.loadLibrary("taskscpp");
+    }
+
+    private TasksLib() {
+    }
+
+    public native void initDitto(
+            Object appContext,
+            String appId,
+            String token,
+            String persistenceDir,
+            boolean isRunningOnEmulator,
+            String customAuthUrl,
+            String websocketUrl);
+
+    public native void terminateDitto();
+
+    public native void insertInitialDocuments();
+
+    public native void startSync();
+
+    public native void stopSync();
+
+    public native boolean isSyncActive();
+
+    public native void createTask(String title, boolean done);
+
+    public native Task getTaskWithId(String taskId);
+
+    public native void updateTask(String taskId, String title, boolean done);
+
+    public native void toggleDoneState(String taskId);
+
+    public native void deleteTask(String taskId);
+
+    public native void setTasksObserver(TasksObserver observer);
+
+    public native void setPackedTasksObserver(PackedTasksObserver observer);
+
+    public native void removeTasksObserver();
+}
@@ -0,0 +1,6 @@
+package live.ditto.quickstart.tasks;
+
+// Desktop stand-in for the Kotlin TasksObserver interface.
+public interface TasksObserver {
+    void onTasksUpdated(String[] tasksJson);
+}
@@ -0,0 +1,25 @@
+package live.ditto.quickstart.tasks.data;
+
+// Desktop stand-in for the Kotlin Task data class.
+//
+// Note: JNI code constructs this with the (String, String, boolean, boolean) constructor, which
+// must match the primary constructor of the Kotlin class.
+public final class Task {
+    public final String _id;
+    public final String title;
+    public final boolean done;
+    public final boolean deleted;
+
+    public Task(String _id, String title, boolean done, boolean deleted) {
+        this._id = _id;
+        this.title = title;
+        this.done = done;
+        this.deleted = deleted;
+    }
+
+    @Override
+    public String toString() {
+        return "Task(_id=" + _id + ", title=" + title + ", done=" + done + ", deleted=" + deleted
+                + ")";
+    }
+}
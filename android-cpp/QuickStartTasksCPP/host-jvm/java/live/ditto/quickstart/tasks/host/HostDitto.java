@@ -0,0 +1,103 @@
+package live.ditto.quickstart.tasks.host;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.Comparator;
+import java.util.stream.Stream;
+
+import live.ditto.quickstart.tasks.TasksLib;
+
+// Shared setup for the host-jvm programs.
+//
+// Ditto is initialized from the same variables as the .env file used by the apps, with a fresh
+// persistence directory that is deleted on close. Sync is not started, so measurements reflect
+// only local work in the JNI bridge and the Ditto store.
+final class HostDitto implements AutoCloseable {
+    // Returned by a test that could not run, so that ctest reports it as skipped
+    static final int EXIT_SKIPPED = 77;
+
+    // ID of one of the initial tasks
+    static final String INITIAL_TASK_ID = "50191411-4C46-4940-8B72-5F8017A04FA7";
+
+    private static final int PACKED_MAGIC = 0x314B5354; // "TSK1"
+    private static final int PACKED_HEADER_SIZE = 8;
+
+    final TasksLib lib = TasksLib.INSTANCE;
+    private final Path persistenceDir;
+
+    private HostDitto(String appId, String token) throws IOException {
+        persistenceDir = Files.createTempDirectory("taskscpp-host-jvm");
+        lib.initDitto(
+                null,
+                appId,
+                token,
+                persistenceDir.toString(),
+                false,
+                envOrEmpty("DITTO_AUTH_URL"),
+                envOrEmpty("DITTO_WEBSOCKET_URL"));
+        lib.insertInitialDocuments();
+    }
+
+    // Initialize Ditto, or return null if the app ID or token is not set.
+    static HostDitto open() throws IOException {
+        final String appId = System.getenv("DITTO_APP_ID");
+        final String token = System.getenv("DITTO_PLAYGROUND_TOKEN");
+        if (appId == null || appId.isEmpty() || token == null || token.isEmpty()) {
+            System.err.println("DITTO_APP_ID and DITTO_PLAYGROUND_TOKEN must be set");
+            return null;
+        }
+        return new HostDitto(appId, token);
+    }
+
+    @Override
+    public void close() throws IOException {
+        lib.removeTasksObserver();
+        lib.terminateDitto();
+        try (Stream<Path> paths = Files.walk(persistenceDir)) {
+            paths.sorted(Comparator.reverseOrder()).forEach(path -> path.toFile().delete());
+        }
+    }
+
+    // Decode every task in a packed snapshot, as the app's PackedTasksReader.toList() does, and
+    // return the number of tasks. Each task is passed to the visitor, which may be null.
+    static int decodePacked(ByteBuffer buffer, PackedTaskVisitor visitor) {
+        final ByteBuffer le = buffer.duplicate().order(ByteOrder.LITTLE_ENDIAN);
+        if (le.limit() < PACKED_HEADER_SIZE || le.getInt(0) != PACKED_MAGIC) {
+            throw new IllegalArgumentException("not a packed tasks buffer");
+        }
+        final int size = le.getInt(4);
+        for (int i = 0; i < size; i++) {
+            final int record = le.getInt(PACKED_HEADER_SIZE + 4 * i);
+            final int flags = le.get(record);
+            final int idOffset = record + 1;
+            final int titleOffset = idOffset + 4 + le.getInt(idOffset);
+            final String id = readString(le, idOffset);
+            final String title = readString(le, titleOffset);
+            if (visitor != null) {
+                visitor.visit(id, title, (flags & 0x01) != 0, (flags & 0x02) != 0);
+            }
+        }
+        return size;
+    }
+
+    interface PackedTaskVisitor {
+        void visit(String id, String title, boolean done, boolean deleted);
+    }
+
+    private static String readString(ByteBuffer buffer, int offset) {
+        final int length = buffer.getInt(offset);
+        final ByteBuffer bytes = buffer.duplicate();
+        bytes.limit(offset + 4 + length);
+        bytes.position(offset + 4);
+        return StandardCharsets.UTF_8.decode(bytes).toString();
+    }
+
+    private static String envOrEmpty(String name) {
+        final String value = System.getenv(name);
+        return value != null ? value : "";
+    }
+}
@@ -0,0 +1,122 @@
+package live.ditto.quickstart.tasks.host;
+
+import java.util.Arrays;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicLong;
+
+import live.ditto.quickstart.tasks.TasksLib;
+
+// Measures the cost of calls through the JNI bridge on a desktop JVM.
+//
+// Usage: TasksLibBenchmark [ITERATIONS] [WARMUP] [OBSERVER_SECONDS]
+//
+// For createTask, getTaskWithId and toggleDoneState, each call is timed individually after a
+// warmup, and the mean, median and 99th percentile are reported. Observer delivery is measured by
+// updating a task continuously from another thread and counting the snapshots delivered to a
+// packed observer and to a JSON observer. Deliveries are coalesced when the observer falls
+// behind, so the number of writes per second is reported alongside.
+public final class TasksLibBenchmark {
+    private static final int DEFAULT_ITERATIONS = 2_000;
+    private static final int DEFAULT_WARMUP = 500;
+    private static final int DEFAULT_OBSERVER_SECONDS = 5;
+
+    private interface Operation {
+        void run(TasksLib lib, int iteration);
+    }
+
+    public static void main(String[] args) throws Exception {
+        final int iterations = args.length > 0 ? Integer.parseInt(args[0]) : DEFAULT_ITERATIONS;
+        final int warmup = args.length > 1 ? Integer.parseInt(args[1]) : DEFAULT_WARMUP;
+        final int observerSeconds =
+                args.length > 2 ? Integer.parseInt(args[2]) : DEFAULT_OBSERVER_SECONDS;
+
+        try (HostDitto ditto = HostDitto.open()) {
+            if (ditto == null) {
+                System.exit(HostDitto.EXIT_SKIPPED);
+            }
+
+            final String id = HostDitto.INITIAL_TASK_ID;
+            System.out.printf("%-26s %12s %12s %12s %12s%n",
+                    "operation", "mean ns", "p50 ns", "p99 ns", "ops/s");
+            measure(ditto.lib, "createTask", iterations, warmup,
+                    (lib, i) -> lib.createTask("Benchmark task " + i, false));
+            measure(ditto.lib, "getTaskWithId", iterations, warmup,
+                    (lib, i) -> lib.getTaskWithId(id));
+            measure(ditto.lib, "toggleDoneState", iterations, warmup,
+                    (lib, i) -> lib.toggleDoneState(id));
+
+            System.out.println();
+            System.out.printf("%-26s %12s %12s %12s%n",
+                    "observer", "writes/s", "updates/s", "tasks/s");
+            measureObserver(ditto.lib, "packed (decoded)", observerSeconds, true);
+            measureObserver(ditto.lib, "JSON (strings only)", observerSeconds, false);
+        }
+    }
+
+    private static void measure(TasksLib lib, String name, int iterations, int warmup,
+                                Operation operation) {
+        for (int i = 0; i < warmup; i++) {
+            operation.run(lib, i);
+        }
+
+        final long[] nanos = new long[iterations];
+        final long start = System.nanoTime();
+        for (int i = 0; i < iterations; i++) {
+            final long t0 = System.nanoTime();
+            operation.run(lib, warmup + i);
+            nanos[i] = System.nanoTime() - t0;
+        }
+        final long total = System.nanoTime() - start;
+
+        Arrays.sort(nanos);
+        System.out.printf("%-26s %12d %12d %12d %12d%n",
+                name,
+                total / iterations,
+                nanos[iterations / 2],
+                nanos[Math.min(iterations - 1, (int) (iterations * 0.99))],
+                iterations * TimeUnit.SECONDS.toNanos(1) / total);
+    }
+
+    private static void measureObserver(TasksLib lib, String name, int seconds, boolean packed)
+            throws InterruptedException {
+        final AtomicLong updates = new AtomicLong();
+        final AtomicLong tasks = new AtomicLong();
+        if (packed) {
+            lib.setPackedTasksObserver(buffer -> {
+                updates.incrementAndGet();
+                tasks.addAndGet(HostDitto.decodePacked(buffer, null));
+            });
+        } else {
+            lib.setTasksObserver(json -> {
+                updates.incrementAndGet();
+                tasks.addAndGet(json.length);
+            });
+        }
+
+        // Let the initial snapshot arrive before counting.
+        Thread.sleep(500);
+        updates.set(0);
+        tasks.set(0);
+
+        final AtomicBoolean running = new AtomicBoolean(true);
+        final AtomicLong writes = new AtomicLong();
+        final Thread writer = new Thread(() -> {
+            while (running.get()) {
+                lib.toggleDoneState(HostDitto.INITIAL_TASK_ID);
+                writes.incrementAndGet();
+            }
+        }, "BenchmarkWriter");
+
+        final long start = System.nanoTime();
+        writer.start();
+        Thread.sleep(TimeUnit.SECONDS.toMillis(seconds));
+        running.set(false);
+        writer.join();
+        final double elapsed = (System.nanoTime() - start) / 1e9;
+        lib.removeTasksObserver();
+
+        System.out.printf("%-26s %12.0f %12.0f %12.0f%n",
+                name, writes.get() / elapsed, updates.get() / elapsed, tasks.get() / elapsed);
+    }
+}
@@ -0,0 +1,104 @@
+package live.ditto.quickstart.tasks.host;
+
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicReference;
+
+import live.ditto.quickstart.tasks.data.Task;
+
+// Checks that the JNI bridge works on a desktop JVM: tasks can be created, observed, read,
+// toggled and deleted, non-ASCII titles survive the round trip through C++ unchanged, and an
+// observer can remove itself from its own callback.
+//
+// Exits with status 0 on success, 1 on failure, and 77 (skipped) if Ditto is not configured.
+public final class TasksLibSmokeTest {
+    private static final String TITLE = "Smoke test 🚀 café ☕ " + System.nanoTime();
+
+    public static void main(String[] args) throws Exception {
+        try (HostDitto ditto = HostDitto.open()) {
+            if (ditto == null) {
+                System.exit(HostDitto.EXIT_SKIPPED);
+            }
+            run(ditto);
+        } catch (AssertionError err) {
+            System.err.println("TasksLibSmokeTest failed: " + err.getMessage());
+            System.exit(1);
+        }
+        System.out.println("TasksLibSmokeTest passed");
+    }
+
+    private static void run(HostDitto ditto) throws InterruptedException {
+        final AtomicReference<String> createdId = new AtomicReference<>();
+        final CountDownLatch created = new CountDownLatch(1);
+        final CountDownLatch deletedFromSnapshot = new CountDownLatch(1);
+        final AtomicBoolean deleteRequested = new AtomicBoolean();
+        ditto.lib.setPackedTasksObserver(tasks -> {
+            final AtomicBoolean present = new AtomicBoolean();
+            HostDitto.decodePacked(tasks, (id, title, done, deleted) -> {
+                if (TITLE.equals(title)) {
+                    present.set(true);
+                    if (createdId.compareAndSet(null, id)) {
+                        created.countDown();
+                    }
+                }
+            });
+            // Snapshots contain only tasks that are not deleted.
+            if (deleteRequested.get() && !present.get()) {
+                deletedFromSnapshot.countDown();
+            }
+        });
+
+        ditto.lib.createTask(TITLE, false);
+        check(created.await(10, TimeUnit.SECONDS), "created task was not observed");
+
+        final String id = createdId.get();
+        Task task = ditto.lib.getTaskWithId(id);
+        check(TITLE.equals(task.title), "title changed in round trip: " + task.title);
+        check(!task.done, "new task is done");
+
+        ditto.lib.toggleDoneState(id);
+        task = ditto.lib.getTaskWithId(id);
+        check(task.done, "toggleDoneState did not mark the task done");
+
+        deleteRequested.set(true);
+        ditto.lib.deleteTask(id);
+        check(deletedFromSnapshot.await(10, TimeUnit.SECONDS),
+                "deleted task is still in the observed tasks");
+        // getTaskWithId() only finds tasks that are not deleted.
+        boolean found;
+        try {
+            ditto.lib.getTaskWithId(id);
+            found = true;
+        } catch (Exception expected) {
+            found = false;
+        }
+        check(!found, "getTaskWithId returned a deleted task");
+
+        removeObserverFromCallback(ditto);
+    }
+
+    // An observer that removes itself runs on the dispatcher thread, which must not wait for
+    // itself to stop.
+    private static void removeObserverFromCallback(HostDitto ditto) throws InterruptedException {
+        ditto.lib.removeTasksObserver();
+        final CountDownLatch removed = new CountDownLatch(1);
+        ditto.lib.setTasksObserver(tasksJson -> {
+            ditto.lib.removeTasksObserver();
+            removed.countDown();
+        });
+        check(removed.await(10, TimeUnit.SECONDS), "observer was not called");
+
+        // Once removed, another observer can be set.
+        final CountDownLatch observedAgain = new CountDownLatch(1);
+        ditto.lib.setTasksObserver(tasksJson -> observedAgain.countDown());
+        check(observedAgain.await(10, TimeUnit.SECONDS), "second observer was not called");
+        ditto.lib.removeTasksObserver();
+    }
+
+    private static void check(boolean condition, String message) {
+        if (!condition) {
+            throw new AssertionError(message);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#include <android/log.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+// Messages below this priority are dropped.  Set TASKSCPP_LOG_LEVEL to change it, using the
+// numeric values of android_LogPriority (e.g. 3 for debug).
+int min_priority() {
+  static const int priority = [] {
+    const char *level = std::getenv("TASKSCPP_LOG_LEVEL");
+    return level != nullptr ? std::atoi(level) : static_cast<int>(ANDROID_LOG_WARN);
+  }();
+  return priority;
+}
+
+char priority_letter(int prio) {
+  switch (prio) {
+  case ANDROID_LOG_VERBOSE:
+    return 'V';
+  case ANDROID_LOG_DEBUG:
+    return 'D';
+  case ANDROID_LOG_INFO:
+    return 'I';
+  case ANDROID_LOG_WARN:
+    return 'W';
+  case ANDROID_LOG_ERROR:
+    return 'E';
+  case ANDROID_LOG_FATAL:
+    return 'F';
+  default:
+    return '?';
+  }
+}
+
+} // end anonymous namespace
+
+extern "C" int __android_log_write(int prio, const char *tag, const char *text) {
+  if (prio < min_priority()) {
+    return 0;
+  }
+  return std::fprintf(stderr, "%c/%s: %s\n", priority_letter(prio), tag, text);
+}
+
+extern "C" int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+  if (prio < min_priority()) {
+    return 0;
+  }
+  char buffer[1024];
+  va_list args;
+  va_start(args, fmt);
+  std::vsnprintf(buffer, sizeof(buffer), fmt, args);
+  va_end(args);
+  return __android_log_write(prio, tag, buffer);
+}
@@ -0,0 +1,155 @@
+// Checks utf16_to_utf8() and utf8_to_utf16() against a straightforward reference encoder: random
+// round trips of valid text, and replacement of invalid input with U+FFFD.
+//
+// Exits with status 0 on success and 1 on failure.
+
+#include "utf_transcode.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char *message) {
+  if (!condition) {
+    std::fprintf(stderr, "utf_transcode_test failed: %s\n", message);
+    ++failures;
+  }
+}
+
+// Encode code points as UTF-16, one at a time.
+std::vector<std::uint16_t> reference_utf16(const std::vector<std::uint32_t> &code_points) {
+  std::vector<std::uint16_t> out;
+  for (const auto cp : code_points) {
+    if (cp >= 0x10000) {
+      out.push_back(static_cast<std::uint16_t>(0xD800 + ((cp - 0x10000) >> 10)));
+      out.push_back(static_cast<std::uint16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF)));
+    } else {
+      out.push_back(static_cast<std::uint16_t>(cp));
+    }
+  }
+  return out;
+}
+
+// Encode code points as UTF-8, one at a time.
+std::string reference_utf8(const std::vector<std::uint32_t> &code_points) {
+  std::string out;
+  for (const auto cp : code_points) {
+    if (cp < 0x80) {
+      out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+      out += static_cast<char>(0xC0 | (cp >> 6));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+      out += static_cast<char>(0xE0 | (cp >> 12));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+      out += static_cast<char>(0xF0 | (cp >> 18));
+      out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+  return out;
+}
+
+// Return a random code point, mostly ASCII so that the word-at-a-time paths are exercised.
+std::uint32_t random_code_point(std::mt19937 &rng) {
+  switch (rng() % 5) {
+  case 0:
+  case 1:
+    return 0x20 + rng() % 95;
+  case 2:
+    return 0x80 + rng() % 0x780;
+  case 3: {
+    std::uint32_t cp;
+    do {
+      cp = 0x800 + rng() % 0xF800;
+    } while (cp >= 0xD800 && cp <= 0xDFFF);
+    return cp;
+  }
+  default:
+    return 0x10000 + rng() % 0x100000;
+  }
+}
+
+void test_round_trips() {
+  std::mt19937 rng(1);
+  std::string utf8;
+  std::vector<std::uint16_t> utf16;
+  for (int iteration = 0; iteration < 20000; ++iteration) {
+    std::vector<std::uint32_t> code_points(rng() % 40);
+    for (auto &cp : code_points) {
+      cp = random_code_point(rng);
+    }
+    const auto expected_utf16 = reference_utf16(code_points);
+    const auto expected_utf8 = reference_utf8(code_points);
+
+    utf16_to_utf8(expected_utf16.data(), expected_utf16.size(), utf8);
+    check(utf8 == expected_utf8, "UTF-16 to UTF-8 differs from reference");
+
+    utf8_to_utf16(expected_utf8.data(), expected_utf8.size(), utf16);
+    check(utf16 == expected_utf16, "UTF-8 to UTF-16 differs from reference");
+  }
+}
+
+void test_invalid_utf16() {
+  const std::uint16_t lone_surrogates[] = {'a', 0xD800, 'b', 0xDC00};
+  std::string out;
+  utf16_to_utf8(lone_surrogates, 4, out);
+  check(out == "a\xEF\xBF\xBD"
+               "b\xEF\xBF\xBD",
+        "unpaired surrogates are not replaced with U+FFFD");
+
+  const std::uint16_t high_at_end[] = {'x', 0xD83D};
+  utf16_to_utf8(high_at_end, 2, out);
+  check(out == "x\xEF\xBF\xBD", "high surrogate at end is not replaced with U+FFFD");
+}
+
+void test_invalid_utf8() {
+  // Overlong, truncated, surrogate and out-of-range sequences.  Each maximal invalid prefix is
+  // replaced with one U+FFFD.
+  const std::string bad = "a\xC0\x80"
+                          "b\xE0\x80"
+                          "c\xED\xA0\x80"
+                          "d\xF4\x90\x80\x80"
+                          "e\xF0\x9F\x98";
+  std::vector<std::uint16_t> out;
+  utf8_to_utf16(bad.data(), bad.size(), out);
+  const std::vector<std::uint16_t> expected = {
+      'a', 0xFFFD, 0xFFFD, 'b', 0xFFFD, 0xFFFD, 'c', 0xFFFD, 0xFFFD, 0xFFFD,
+      'd', 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD, 'e', 0xFFFD};
+  check(out == expected, "invalid UTF-8 is not replaced as expected");
+}
+
+void test_result_size() {
+  // A long ASCII string must not keep the worst-case allocation.
+  const std::vector<std::uint16_t> ascii(10000, 'a');
+  std::string out;
+  utf16_to_utf8(ascii.data(), ascii.size(), out);
+  check(out.size() == ascii.size(), "ASCII result has the wrong size");
+  check(out.capacity() < 2 * ascii.size(), "result keeps worst-case capacity");
+
+  utf16_to_utf8(ascii.data(), 0, out);
+  check(out.empty(), "empty input does not produce an empty result");
+}
+
+} // end anonymous namespace
+
+int main() {
+  test_round_trips();
+  test_invalid_utf16();
+  test_invalid_utf8();
+  test_result_size();
+  if (failures > 0) {
+    return 1;
+  }
+  std::puts("utf_transcode_test passed");
+  return 0;
+}
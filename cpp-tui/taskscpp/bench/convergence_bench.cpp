@@ -0,0 +1,431 @@
+// Measures how long N peers take to converge after a burst of writes.
+//
+// All peers run in this process, each with its own temporary persistence
+// directory, and sync over loopback TCP: peer 0 listens on --base-port and the
+// others connect to it.  Every peer observes the tasks collection, and records
+// when it first sees the expected final state.
+//
+// Write patterns:
+//   disjoint  each peer adds its own share of --writes new tasks
+//   hot-key   each peer repeatedly retitles the same task
+//   bulk      peer 0 adds all --writes tasks
+//
+// For each peer count, the report shows the time from the start of the writes
+// until every peer had converged, the distribution of that time across peers,
+// and the CPU time and memory used by the process during the run.
+//
+// The peers use an offline playground identity for the app ID from the .env
+// file, so the run needs no network access.  If the SDK requires a license
+// token for offline identities, set it in DITTO_OFFLINE_LICENSE_TOKEN.
+//
+// Usage: convergence_bench [--peers N] [--scale] [--writes N]
+//                          [--pattern disjoint|hot-key|bulk] [--timeout SEC]
+
+#include "env.h"
+#include "tasks_peer.h"
+
+#include "cxxopts.hpp"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+enum class Pattern { Disjoint, HotKey, Bulk };
+
+struct RunOptions {
+  size_t peers;
+  size_t writes;
+  Pattern pattern;
+  uint16_t port;
+  chrono::seconds timeout;
+  filesystem::path directory;
+};
+
+struct RunResult {
+  bool converged = false;
+  double total_ms = 0;          // until the last peer converged
+  vector<double> peer_ms;       // per peer, sorted
+  double cpu_seconds = 0;       // user + system time during the run
+  double rss_growth_mb = 0;     // growth of resident memory during the run
+};
+
+// Return the license token for the peers' offline identity, or an empty
+// string if DITTO_OFFLINE_LICENSE_TOKEN is not set.
+string offline_license_token() {
+  const char *token = getenv("DITTO_OFFLINE_LICENSE_TOKEN");
+  return token != nullptr ? token : "";
+}
+
+Pattern parse_pattern(const string &name) {
+  if (name == "disjoint") {
+    return Pattern::Disjoint;
+  } else if (name == "hot-key") {
+    return Pattern::HotKey;
+  } else if (name == "bulk") {
+    return Pattern::Bulk;
+  }
+  throw invalid_argument("unknown pattern: " + name);
+}
+
+double cpu_seconds() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  const auto seconds = [](const timeval &tv) {
+    return static_cast<double>(tv.tv_sec) + tv.tv_usec / 1e6;
+  };
+  return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+double resident_mb() {
+  ifstream statm("/proc/self/statm");
+  size_t size_pages = 0;
+  size_t resident_pages = 0;
+  statm >> size_pages >> resident_pages;
+  return static_cast<double>(resident_pages) * sysconf(_SC_PAGESIZE) /
+         (1024.0 * 1024.0);
+}
+
+/// Convergence state of one peer, updated by its tasks observer.
+struct PeerState {
+  mutex mtx;
+  optional<Clock::time_point> converged_at;
+  string hot_title; // latest title of the hot-key task, for that pattern
+  Clock::time_point hot_title_changed_at;
+  size_t matching_tasks = 0;
+};
+
+class ConvergenceRun {
+public:
+  explicit ConvergenceRun(RunOptions options) : options(std::move(options)) {
+    prefix =
+        "conv-" + to_string(Clock::now().time_since_epoch().count()) + "-";
+    hot_id = prefix + "hot";
+  }
+
+  RunResult run() {
+    const auto cpu_before = cpu_seconds();
+    const auto rss_before = resident_mb();
+
+    start_peers();
+    if (options.pattern == Pattern::HotKey) {
+      seed_hot_task();
+    }
+
+    armed = true;
+    const auto start = Clock::now();
+    write();
+    writes_done_at = Clock::now();
+    writes_done = true;
+
+    RunResult result;
+    result.converged = wait_for_convergence(start + options.timeout);
+    const auto end = Clock::now();
+
+    for (auto &state : states) {
+      lock_guard<mutex> lock(state->mtx);
+      const auto at = converged_time(*state).value_or(end);
+      result.peer_ms.push_back(
+          chrono::duration<double, milli>(at - start).count());
+    }
+    sort(result.peer_ms.begin(), result.peer_ms.end());
+    result.total_ms = result.peer_ms.back();
+    result.cpu_seconds = cpu_seconds() - cpu_before;
+    result.rss_growth_mb = resident_mb() - rss_before;
+
+    observers.clear();
+    for (auto &peer : peers) {
+      peer->stop_sync();
+    }
+    peers.clear();
+    return result;
+  }
+
+private:
+  RunOptions options;
+  string prefix;
+  string hot_id;
+  vector<unique_ptr<TasksPeer>> peers;
+  vector<unique_ptr<PeerState>> states;
+  vector<shared_ptr<ditto::StoreObserver>> observers;
+  atomic<bool> armed{false};
+  atomic<bool> writes_done{false};
+  Clock::time_point writes_done_at;
+  string final_hot_title; // title of the hot-key task before the writes
+
+  void start_peers() {
+    for (size_t i = 0; i < options.peers; ++i) {
+      TransportOptions transport;
+      transport.profile = TransportProfile::Tcp;
+      transport.offline_identity = true;
+      transport.offline_license_token = offline_license_token();
+      if (i == 0) {
+        transport.tcp_listen_address = "127.0.0.1";
+        transport.tcp_listen_port = options.port;
+      } else {
+        transport.tcp_connect_addresses.push_back("127.0.0.1:" +
+                                                  to_string(options.port));
+      }
+      const auto dir = options.directory / ("peer" + to_string(i));
+      filesystem::create_directories(dir);
+      peers.push_back(make_unique<TasksPeer>(
+          DITTO_APP_ID, DITTO_PLAYGROUND_TOKEN, DITTO_WEBSOCKET_URL,
+          DITTO_AUTH_URL, false, dir.string(), transport));
+      states.push_back(make_unique<PeerState>());
+
+      auto *state = states.back().get();
+      observers.push_back(peers.back()->register_tasks_observer(
+          [this, state](const vector<Task> &tasks) {
+            observe(*state, tasks);
+          }));
+      peers.back()->start_sync();
+    }
+  }
+
+  // Create the hot-key task on peer 0, and wait until every peer has it.
+  void seed_hot_task() {
+    final_hot_title = prefix + "seed";
+    peers[0]->upsert_task(Task(hot_id, final_hot_title));
+    wait_until(Clock::now() + options.timeout, [this] {
+      return all_of(states.begin(), states.end(), [this](const auto &state) {
+        lock_guard<mutex> lock(state->mtx);
+        return state->hot_title == final_hot_title;
+      });
+    });
+  }
+
+  void write() {
+    switch (options.pattern) {
+    case Pattern::Disjoint: {
+      vector<thread> writers;
+      for (size_t i = 0; i < peers.size(); ++i) {
+        writers.emplace_back([this, i] {
+          for (size_t k = i; k < options.writes; k += peers.size()) {
+            peers[i]->add_task(prefix + to_string(k), false);
+          }
+        });
+      }
+      for (auto &writer : writers) {
+        writer.join();
+      }
+      break;
+    }
+    case Pattern::HotKey: {
+      vector<thread> writers;
+      for (size_t i = 0; i < peers.size(); ++i) {
+        writers.emplace_back([this, i] {
+          for (size_t k = i; k < options.writes; k += peers.size()) {
+            peers[i]->update_task_title(hot_id, prefix + to_string(k));
+          }
+        });
+      }
+      for (auto &writer : writers) {
+        writer.join();
+      }
+      break;
+    }
+    case Pattern::Bulk:
+      for (size_t k = 0; k < options.writes; ++k) {
+        peers[0]->add_task(prefix + to_string(k), false);
+      }
+      break;
+    }
+  }
+
+  void observe(PeerState &state, const vector<Task> &tasks) {
+    const auto now = Clock::now();
+    lock_guard<mutex> lock(state.mtx);
+    if (options.pattern == Pattern::HotKey) {
+      for (const auto &task : tasks) {
+        if (task._id == hot_id && task.title != state.hot_title) {
+          state.hot_title = task.title;
+          state.hot_title_changed_at = now;
+        }
+      }
+      return;
+    }
+
+    state.matching_tasks = static_cast<size_t>(
+        count_if(tasks.begin(), tasks.end(), [this](const Task &task) {
+          return task.title.compare(0, prefix.size(), prefix) == 0;
+        }));
+    if (armed && !state.converged_at &&
+        state.matching_tasks == options.writes) {
+      state.converged_at = now;
+    }
+  }
+
+  // For the hot-key pattern, a peer has converged once it shows the same
+  // title as every other peer; its convergence time is when it last changed.
+  optional<Clock::time_point> converged_time(const PeerState &state) const {
+    if (options.pattern != Pattern::HotKey) {
+      return state.converged_at;
+    }
+    if (!hot_key_agreed) {
+      return nullopt;
+    }
+    return max(state.hot_title_changed_at, writes_done_at);
+  }
+
+  bool hot_key_agreed = false;
+
+  bool all_converged() {
+    if (!writes_done) {
+      return false;
+    }
+    if (options.pattern == Pattern::HotKey) {
+      optional<string> title;
+      for (const auto &state : states) {
+        lock_guard<mutex> lock(state->mtx);
+        if (state->hot_title.compare(0, prefix.size(), prefix) != 0 ||
+            (title && *title != state->hot_title)) {
+          return false;
+        }
+        title = state->hot_title;
+      }
+      hot_key_agreed = true;
+      return true;
+    }
+    return all_of(states.begin(), states.end(), [](const auto &state) {
+      lock_guard<mutex> lock(state->mtx);
+      return state->converged_at.has_value();
+    });
+  }
+
+  bool wait_for_convergence(Clock::time_point deadline) {
+    // A peer may briefly agree before a straggling write arrives, so require
+    // the agreement to hold for a short while.
+    constexpr auto settle = chrono::milliseconds(200);
+    optional<Clock::time_point> agreed_since;
+    while (Clock::now() < deadline) {
+      if (all_converged()) {
+        if (!agreed_since) {
+          agreed_since = Clock::now();
+        } else if (Clock::now() - *agreed_since >= settle ||
+                   options.pattern != Pattern::HotKey) {
+          return true;
+        }
+      } else {
+        agreed_since.reset();
+      }
+      this_thread::sleep_for(chrono::milliseconds(5));
+    }
+    return false;
+  }
+
+  template <class Predicate>
+  static void wait_until(Clock::time_point deadline, Predicate done) {
+    while (!done() && Clock::now() < deadline) {
+      this_thread::sleep_for(chrono::milliseconds(5));
+    }
+  }
+};
+
+void report(size_t peers, const RunResult &r) {
+  const auto percentile = [&r](double p) {
+    return r.peer_ms[min(r.peer_ms.size() - 1,
+                         static_cast<size_t>(p * r.peer_ms.size()))];
+  };
+  printf("%6zu %10s %12.1f %12.1f %12.1f %12.1f %10.2f %10.1f\n", peers,
+         r.converged ? "yes" : "TIMEOUT", r.total_ms, percentile(0.0),
+         percentile(0.5), percentile(0.9), r.cpu_seconds, r.rss_growth_mb);
+}
+
+} // end anonymous namespace
+
+int main(int argc, const char *argv[]) {
+  cxxopts::Options options("convergence_bench",
+                           "Measure convergence time of peers syncing over "
+                           "loopback TCP");
+  // clang-format off
+  options.add_options()
+    ("h,help", "Print usage")
+    ("peers", "Number of peers (maximum number with --scale)",
+      cxxopts::value<size_t>()->default_value("4"), "N")
+    ("scale", "Run with 2, 4, 8, ... peers, up to --peers")
+    ("writes", "Number of writes in each run",
+      cxxopts::value<size_t>()->default_value("200"), "N")
+    ("pattern", "Write pattern: disjoint, hot-key, or bulk",
+      cxxopts::value<string>()->default_value("disjoint"), "PATTERN")
+    ("base-port", "First TCP port used on 127.0.0.1",
+      cxxopts::value<uint16_t>()->default_value("47100"), "PORT")
+    ("timeout", "Seconds to wait for convergence in each run",
+      cxxopts::value<unsigned>()->default_value("120"), "SEC");
+  // clang-format on
+  const auto opt_parse = options.parse(argc, argv);
+  if (opt_parse.count("help") > 0) {
+    cout << options.help() << endl;
+    return 0;
+  }
+
+  const auto max_peers = opt_parse["peers"].as<size_t>();
+  const auto writes = opt_parse["writes"].as<size_t>();
+  if (max_peers < 2 || writes == 0) {
+    cerr << "error: --peers must be at least 2 and --writes greater than zero"
+         << endl;
+    return 1;
+  }
+
+  vector<size_t> peer_counts;
+  if (opt_parse.count("scale") > 0) {
+    for (size_t n = 2; n <= max_peers; n *= 2) {
+      peer_counts.push_back(n);
+    }
+  } else {
+    peer_counts.push_back(max_peers);
+  }
+
+  const auto root = filesystem::temp_directory_path() /
+                    ("convergence_bench_" +
+                     to_string(Clock::now().time_since_epoch().count()));
+
+  try {
+    const auto pattern_name = opt_parse["pattern"].as<string>();
+    const auto pattern = parse_pattern(pattern_name);
+    auto port = opt_parse["base-port"].as<uint16_t>();
+    const auto timeout_sec = opt_parse["timeout"].as<unsigned>();
+
+    printf("pattern: %s, writes: %zu\n\n", pattern_name.c_str(), writes);
+    printf("%6s %10s %12s %12s %12s %12s %10s %10s\n", "peers", "converged",
+           "total (ms)", "first (ms)", "p50 (ms)", "p90 (ms)", "cpu (s)",
+           "rss (MB)");
+    for (const auto n : peer_counts) {
+      // A new port for each run avoids waiting for the last one to be freed.
+      RunOptions run_options;
+      run_options.peers = n;
+      run_options.writes = writes;
+      run_options.pattern = pattern;
+      run_options.port = port++;
+      run_options.timeout = chrono::seconds(timeout_sec);
+      run_options.directory = root / ("n" + to_string(n));
+      ConvergenceRun run(run_options);
+      report(n, run.run());
+    }
+  } catch (const exception &err) {
+    cerr << "error: " << err.what() << endl;
+    filesystem::remove_all(root);
+    return 1;
+  }
+
+  filesystem::remove_all(root);
+  return 0;
+}
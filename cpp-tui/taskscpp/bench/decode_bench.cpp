@@ -0,0 +1,171 @@
+// Measures allocations and latency of decoding observer snapshots into Task
+// objects, comparing the original approach (a new vector and a parsed
+// nlohmann::json object per row) with the recycled buffer used by TasksPeer.
+//
+// Each iteration simulates one observer firing after a single task changed.
+// Only the decoding step is measured; the JSON text of each row is prepared in
+// advance, as it is produced by the Ditto SDK.
+//
+// Usage: decode_bench [--tasks N] [--iterations N]
+
+#include "task.h"
+
+#include "cxxopts.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+atomic<size_t> allocation_count{0};
+
+} // end anonymous namespace
+
+// Count every allocation made through the global operator new.
+void *operator new(size_t size) {
+  ++allocation_count;
+  if (void *p = malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct Measurement {
+  double allocations_per_snapshot;
+  double p50_us;
+  double p99_us;
+  double max_us;
+};
+
+// Produce the JSON text of each row of a snapshot.
+vector<string> make_rows(size_t count) {
+  vector<string> rows;
+  rows.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    char id[40];
+    snprintf(id, sizeof(id), "%08zx-0000-4000-8000-%012zx", i, i * 7919);
+    nlohmann::json j =
+        Task(id, "Task number " + to_string(i) + " with a typical title",
+             i % 3 == 0, false);
+    rows.push_back(j.dump());
+  }
+  return rows;
+}
+
+// Simulate a change to one task by toggling its "done" flag in place.
+void mutate_row(string &row) {
+  const auto pos = row.find("\"done\":");
+  if (pos == string::npos) {
+    return;
+  }
+  const auto value = pos + 7;
+  if (row.compare(value, 4, "true") == 0) {
+    row.replace(value, 4, "false");
+  } else {
+    row.replace(value, 5, "true");
+  }
+}
+
+Measurement measure(vector<string> rows, unsigned iterations,
+                    const function<void(const vector<string> &)> &decode) {
+  // Warm up, so that recycled buffers reach their steady-state size.
+  decode(rows);
+
+  vector<double> latencies_us;
+  latencies_us.reserve(iterations);
+  size_t allocations = 0;
+  for (unsigned i = 0; i < iterations; ++i) {
+    mutate_row(rows[i % rows.size()]);
+
+    const auto allocations_before = allocation_count.load();
+    const auto start = Clock::now();
+    decode(rows);
+    const auto elapsed = Clock::now() - start;
+    allocations += allocation_count.load() - allocations_before;
+
+    latencies_us.push_back(chrono::duration<double, micro>(elapsed).count());
+  }
+
+  sort(latencies_us.begin(), latencies_us.end());
+  const auto percentile = [&latencies_us](double p) {
+    return latencies_us[min(latencies_us.size() - 1,
+                            static_cast<size_t>(p * latencies_us.size()))];
+  };
+  return {double(allocations) / iterations, percentile(0.50), percentile(0.99),
+          latencies_us.back()};
+}
+
+void report(const char *name, const Measurement &m) {
+  printf("%-24s %16.1f %10.1f %10.1f %10.1f\n", name,
+         m.allocations_per_snapshot, m.p50_us, m.p99_us, m.max_us);
+}
+
+} // end anonymous namespace
+
+int main(int argc, const char *argv[]) {
+  cxxopts::Options options("decode_bench",
+                           "Measure decoding of observer snapshots");
+  // clang-format off
+  options.add_options()
+    ("h,help", "Print usage")
+    ("tasks", "Number of tasks in each snapshot",
+      cxxopts::value<size_t>()->default_value("1000"), "N")
+    ("iterations", "Number of snapshots to decode",
+      cxxopts::value<unsigned>()->default_value("1000"), "N");
+  // clang-format on
+  const auto opt_parse = options.parse(argc, argv);
+  if (opt_parse.count("help") > 0) {
+    cout << options.help() << endl;
+    return 0;
+  }
+  const auto count = opt_parse["tasks"].as<size_t>();
+  const auto iterations = opt_parse["iterations"].as<unsigned>();
+  if (count == 0 || iterations == 0) {
+    cerr << "error: --tasks and --iterations must be greater than zero" << endl;
+    return 1;
+  }
+
+  const auto rows = make_rows(count);
+
+  const auto before = measure(rows, iterations, [](const vector<string> &rows) {
+    vector<Task> tasks;
+    tasks.reserve(rows.size());
+    for (const auto &row : rows) {
+      tasks.emplace_back(nlohmann::json::parse(row).get<Task>());
+    }
+  });
+
+  vector<Task> recycled;
+  const auto after =
+      measure(rows, iterations, [&recycled](const vector<string> &rows) {
+        recycled.resize(rows.size());
+        for (size_t i = 0; i < rows.size(); ++i) {
+          from_json_string(rows[i], recycled[i]);
+        }
+      });
+
+  printf("tasks per snapshot: %zu, snapshots: %u\n\n", count, iterations);
+  printf("%-24s %16s %10s %10s %10s\n", "", "allocs/snapshot", "p50 (us)",
+         "p99 (us)", "max (us)");
+  report("new vector + json::parse", before);
+  report("recycled vector", after);
+  return 0;
+}
@@ -0,0 +1,187 @@
+// Measures the latency of the application's hot queries against a large tasks
+// collection, first without indexes and then with the indexes that TasksPeer
+// creates at startup.
+//
+// The collection is built in a temporary local store, with a configurable
+// fraction of tombstones (deleted tasks), since filtering them out is what the
+// `deleted` index speeds up.  Sync is never started.
+//
+// Usage: index_bench [--tasks N] [--deleted-fraction F] [--iterations N]
+
+#include "tasks_peer.h"
+
+#include "Ditto.h"
+#include "cxxopts.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+// Number of documents inserted by each INSERT statement while populating.
+constexpr size_t INSERT_BATCH_SIZE = 500;
+
+struct BenchQuery {
+  const char *name;
+  string query;
+};
+
+struct Measurement {
+  double p50_us;
+  double p99_us;
+  size_t rows;
+};
+
+string task_id(size_t i) {
+  char id[40];
+  snprintf(id, sizeof(id), "%08zx-0000-4000-8000-%012zx", i, i * 7919);
+  return id;
+}
+
+void populate(ditto::Store &store, size_t count, double deleted_fraction) {
+  const auto deleted_per_thousand =
+      static_cast<size_t>(deleted_fraction * 1000);
+  for (size_t start = 0; start < count; start += INSERT_BATCH_SIZE) {
+    const auto end = min(count, start + INSERT_BATCH_SIZE);
+    string command = "INSERT INTO tasks DOCUMENTS ";
+    json args = json::object();
+    for (size_t i = start; i < end; ++i) {
+      const auto name = "t" + to_string(i - start);
+      command += (i == start ? "(:" : ", (:") + name + ")";
+      const bool deleted = i % 1000 < deleted_per_thousand;
+      args[name] = {{"_id", task_id(i)},
+                    {"title", "Task number " + to_string(i)},
+                    {"done", i % 3 == 0},
+                    {"deleted", deleted},
+                    {"modified_at", static_cast<int64_t>(i)}};
+    }
+    store.execute(command, args);
+  }
+}
+
+Measurement measure(ditto::Store &store, const string &query,
+                    unsigned iterations) {
+  store.execute(query); // warm up
+
+  vector<double> latencies_us;
+  latencies_us.reserve(iterations);
+  size_t rows = 0;
+  for (unsigned i = 0; i < iterations; ++i) {
+    const auto start = Clock::now();
+    const auto result = store.execute(query);
+    const auto elapsed = Clock::now() - start;
+    rows = result.item_count();
+    latencies_us.push_back(chrono::duration<double, micro>(elapsed).count());
+  }
+
+  sort(latencies_us.begin(), latencies_us.end());
+  const auto percentile = [&latencies_us](double p) {
+    return latencies_us[min(latencies_us.size() - 1,
+                            static_cast<size_t>(p * latencies_us.size()))];
+  };
+  return {percentile(0.50), percentile(0.99), rows};
+}
+
+} // end anonymous namespace
+
+int main(int argc, const char *argv[]) {
+  cxxopts::Options options("index_bench",
+                           "Measure query latency with and without indexes");
+  // clang-format off
+  options.add_options()
+    ("h,help", "Print usage")
+    ("tasks", "Number of tasks in the collection",
+      cxxopts::value<size_t>()->default_value("100000"), "N")
+    ("deleted-fraction", "Fraction of tasks that are deleted",
+      cxxopts::value<double>()->default_value("0.9"), "F")
+    ("iterations", "Number of times each query is run",
+      cxxopts::value<unsigned>()->default_value("50"), "N");
+  // clang-format on
+  const auto opt_parse = options.parse(argc, argv);
+  if (opt_parse.count("help") > 0) {
+    cout << options.help() << endl;
+    return 0;
+  }
+  const auto count = opt_parse["tasks"].as<size_t>();
+  const auto deleted_fraction = opt_parse["deleted-fraction"].as<double>();
+  const auto iterations = opt_parse["iterations"].as<unsigned>();
+  if (count == 0 || iterations == 0 || deleted_fraction < 0 ||
+      deleted_fraction >= 1) {
+    cerr << "error: --tasks and --iterations must be greater than zero, and "
+            "--deleted-fraction must be in [0, 1)"
+         << endl;
+    return 1;
+  }
+
+  const auto persistence_dir =
+      filesystem::temp_directory_path() /
+      ("index_bench_" + to_string(Clock::now().time_since_epoch().count()));
+
+  try {
+    ditto::Ditto ditto(ditto::Identity::OfflinePlayground(),
+                       persistence_dir.string());
+    ditto.disable_sync_with_v3();
+    auto &store = ditto.get_store();
+    store.execute("ALTER SYSTEM SET DQL_STRICT_MODE = false");
+
+    printf("populating %zu tasks (%.0f%% deleted)...\n", count,
+           deleted_fraction * 100);
+    populate(store, count, deleted_fraction);
+
+    const vector<BenchQuery> queries = {
+        {"list undeleted",
+         "SELECT * FROM tasks WHERE NOT deleted ORDER BY _id"},
+        {"tombstone batch",
+         "SELECT _id FROM tasks WHERE deleted = true LIMIT 100"},
+        {"completed undeleted",
+         "SELECT _id FROM tasks WHERE done = true AND NOT deleted"},
+        {"get by _id",
+         "SELECT * FROM tasks WHERE _id = '" + task_id(count / 2) + "'"},
+    };
+
+    vector<Measurement> without;
+    for (const auto &q : queries) {
+      without.push_back(measure(store, q.query, iterations));
+    }
+
+    const auto index_start = Clock::now();
+    for (const auto &stmt : TasksPeer::get_index_statements()) {
+      store.execute(stmt);
+    }
+    const auto index_ms =
+        chrono::duration<double, milli>(Clock::now() - index_start).count();
+
+    vector<Measurement> with;
+    for (const auto &q : queries) {
+      with.push_back(measure(store, q.query, iterations));
+    }
+
+    printf("creating indexes took %.1f ms\n\n", index_ms);
+    printf("%-20s %8s %14s %14s %14s %14s\n", "", "rows", "p50 no index",
+           "p99 no index", "p50 indexed", "p99 indexed");
+    for (size_t i = 0; i < queries.size(); ++i) {
+      printf("%-20s %8zu %11.1f us %11.1f us %11.1f us %11.1f us\n",
+             queries[i].name, with[i].rows, without[i].p50_us,
+             without[i].p99_us, with[i].p50_us, with[i].p99_us);
+    }
+  } catch (const exception &err) {
+    cerr << "error: " << err.what() << endl;
+    filesystem::remove_all(persistence_dir);
+    return 1;
+  }
+
+  filesystem::remove_all(persistence_dir);
+  return 0;
+}
@@ -0,0 +1,219 @@
+// Compares memory use and scan throughput of TaskTable against
+// std::vector<Task>.
+//
+// Usage: task_table_bench [--tasks N] [--passes N]
+
+#include "task.h"
+#include "task_table.h"
+
+#include "cxxopts.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+// Prevent the optimizer from discarding benchmark results.
+volatile size_t sink;
+
+string random_uuid(mt19937_64 &rng, bool upper) {
+  const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  string id(36, '-');
+  for (size_t i = 0; i < id.size(); ++i) {
+    if (i != 8 && i != 13 && i != 18 && i != 23) {
+      id[i] = digits[rng() % 16];
+    }
+  }
+  return id;
+}
+
+// Generate tasks sorted by ID.  Most IDs are lowercase UUIDs, as generated by
+// the Ditto SDKs; a few are uppercase, like the QuickStart initial tasks.
+vector<Task> make_tasks(size_t count) {
+  mt19937_64 rng(42);
+  uniform_int_distribution<size_t> title_length(8, 64);
+  vector<Task> tasks;
+  tasks.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    string title(title_length(rng), 'x');
+    for (auto &c : title) {
+      c = static_cast<char>('a' + rng() % 26);
+    }
+    auto &task = tasks.emplace_back(random_uuid(rng, i % 16 == 0),
+                                    std::move(title), rng() % 2 == 0,
+                                    rng() % 8 == 0);
+    task.body_size = rng() % 4 == 0 ? rng() % 4096 : 0;
+    task.created_at = 1700000000000 + static_cast<int64_t>(rng() % 1000000);
+    task.modified_at = task.created_at + static_cast<int64_t>(rng() % 1000);
+  }
+  sort(tasks.begin(), tasks.end(),
+       [](const Task &a, const Task &b) { return a._id < b._id; });
+  return tasks;
+}
+
+size_t string_heap_bytes(const string &s) {
+  static const auto sso_capacity = string().capacity();
+  return s.capacity() > sso_capacity ? s.capacity() + 1 : 0;
+}
+
+size_t vector_memory_usage(const vector<Task> &tasks) {
+  size_t bytes = tasks.capacity() * sizeof(Task);
+  for (const auto &task : tasks) {
+    bytes += string_heap_bytes(task._id) + string_heap_bytes(task.title);
+  }
+  return bytes;
+}
+
+// Run fn the given number of times and return the mean time per run in
+// nanoseconds.
+double time_ns(unsigned passes, const function<size_t()> &fn) {
+  const auto start = Clock::now();
+  for (unsigned i = 0; i < passes; ++i) {
+    sink = fn();
+  }
+  const auto elapsed = Clock::now() - start;
+  return chrono::duration<double, nano>(elapsed).count() / passes;
+}
+
+void report(const char *name, size_t count, double vector_ns,
+            double table_ns) {
+  printf("%-28s %14.1f %14.1f %9.2fx\n", name, vector_ns / count,
+         table_ns / count, vector_ns / table_ns);
+}
+
+} // end anonymous namespace
+
+int main(int argc, const char *argv[]) {
+  cxxopts::Options options("task_table_bench",
+                           "Compare TaskTable with std::vector<Task>");
+  // clang-format off
+  options.add_options()
+    ("h,help", "Print usage")
+    ("tasks", "Number of tasks",
+      cxxopts::value<size_t>()->default_value("100000"), "N")
+    ("passes", "Number of passes over the tasks for each measurement",
+      cxxopts::value<unsigned>()->default_value("20"), "N");
+  // clang-format on
+  const auto opt_parse = options.parse(argc, argv);
+  if (opt_parse.count("help") > 0) {
+    cout << options.help() << endl;
+    return 0;
+  }
+  const auto count = opt_parse["tasks"].as<size_t>();
+  const auto passes = opt_parse["passes"].as<unsigned>();
+  if (count == 0 || passes == 0) {
+    cerr << "error: --tasks and --passes must be greater than zero" << endl;
+    return 1;
+  }
+
+  const auto tasks = make_tasks(count);
+  const auto tasks_copy = tasks;
+  const TaskTable table(tasks);
+  const TaskTable table_copy(tasks);
+  if (table.to_tasks() != tasks) {
+    cerr << "error: TaskTable did not preserve the tasks" << endl;
+    return 1;
+  }
+
+  printf("tasks: %zu, passes: %u\n\n", count, passes);
+  printf("%-28s %14s %14s %10s\n", "", "vector<Task>", "TaskTable", "ratio");
+  printf("%-28s %14.1f %14.1f %9.2fx\n", "bytes per task",
+         double(vector_memory_usage(tasks)) / count,
+         double(table.memory_usage()) / count,
+         double(vector_memory_usage(tasks)) / table.memory_usage());
+  printf("\nnanoseconds per task:\n");
+
+  report("scan done/deleted flags", count,
+         time_ns(passes,
+                 [&tasks] {
+                   size_t open = 0;
+                   for (const auto &task : tasks) {
+                     open += !task.done && !task.deleted;
+                   }
+                   return open;
+                 }),
+         time_ns(passes, [&table] {
+           size_t open = 0;
+           for (const auto row : table) {
+             open += !row.done() && !row.deleted();
+           }
+           return open;
+         }));
+
+  report("scan title lengths", count,
+         time_ns(passes,
+                 [&tasks] {
+                   size_t total = 0;
+                   for (const auto &task : tasks) {
+                     total += task.title.size();
+                   }
+                   return total;
+                 }),
+         time_ns(passes, [&table] {
+           size_t total = 0;
+           for (const auto row : table) {
+             total += row.title().size();
+           }
+           return total;
+         }));
+
+  report("hash ids", count,
+         time_ns(passes,
+                 [&tasks] {
+                   size_t total = 0;
+                   for (const auto &task : tasks) {
+                     total ^= hash<string>()(task._id);
+                   }
+                   return total;
+                 }),
+         time_ns(passes, [&table] {
+           size_t total = 0;
+           for (size_t i = 0; i < table.size(); ++i) {
+             total ^= table.hash_id(i);
+           }
+           return total;
+         }));
+
+  report("find by id (binary search)", count,
+         time_ns(passes,
+                 [&tasks] {
+                   size_t found = 0;
+                   for (const auto &task : tasks) {
+                     const auto it = lower_bound(
+                         tasks.cbegin(), tasks.cend(), task._id,
+                         [](const Task &t, const string &id) {
+                           return t._id < id;
+                         });
+                     found += it != tasks.cend() && it->_id == task._id;
+                   }
+                   return found;
+                 }),
+         time_ns(passes, [&tasks, &table] {
+           size_t found = 0;
+           for (const auto &task : tasks) {
+             found += table.find(task._id) != TaskTable::npos;
+           }
+           return found;
+         }));
+
+  report("compare equal collections", count,
+         time_ns(passes,
+                 [&tasks, &tasks_copy] {
+                   return static_cast<size_t>(tasks_copy == tasks);
+                 }),
+         time_ns(passes, [&table, &table_copy] {
+           return static_cast<size_t>(table_copy == table);
+         }));
+
+  return 0;
+}
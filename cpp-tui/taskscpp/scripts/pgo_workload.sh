@@ -0,0 +1,87 @@
+#!/usr/bin/env bash
+
+# Training workload for profile-guided optimization of taskscpp.
+#
+# Each round runs taskscpp once against a fresh temporary persistence
+# directory, exercising the hot paths of the CLI: adding tasks, toggling and
+# retitling them, running queries, listing, and monitoring, so that the
+# observer decodes a snapshot for every change.  Synchronization delays are
+# disabled, so the workload does not depend on other peers.
+#
+# The elapsed time of each round is printed, so the script can also be used
+# to compare builds (see the Makefile's compare-builds target).
+#
+# Usage: scripts/pgo_workload.sh TASKSCPP [ROUNDS] [TASKS_PER_ROUND]
+
+set -euo pipefail
+
+if [[ $# -lt 1 ]]; then
+  echo "usage: $0 TASKSCPP [ROUNDS] [TASKS_PER_ROUND]" >&2
+  exit 2
+fi
+
+TASKSCPP=$1
+ROUNDS=${2:-5}
+TASKS_PER_ROUND=${3:-200}
+
+WORK_DIR=$(mktemp -d "${TMPDIR:-/tmp}/taskscpp-pgo.XXXXXX")
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+# IDs of the initial tasks inserted by every peer.
+INITIAL_TASKS=(50191 6DA28 5303D 38411)
+
+now_ms() {
+  # date +%N is not available everywhere, so fall back to whole seconds.
+  local ns
+  ns=$(date +%s%N)
+  if [[ $ns == *N ]]; then
+    echo $(($(date +%s) * 1000))
+  else
+    echo $((ns / 1000000))
+  fi
+}
+
+run_round() {
+  local round=$1
+  local args=(--pre 0 --post 0 -p "$WORK_DIR/round-$round" --monitor)
+
+  for ((i = 0; i < TASKS_PER_ROUND; i++)); do
+    args+=(--add "Training task $round.$i")
+  done
+  for id in "${INITIAL_TASKS[@]}"; do
+    args+=(--toggle "$id" --title "$id,Retitled in round $round")
+  done
+  args+=(--delete "${INITIAL_TASKS[3]}")
+  args+=(--query "SELECT * FROM tasks WHERE done = true")
+  args+=(--query "SELECT * FROM tasks WHERE NOT deleted ORDER BY title")
+  args+=(--list)
+
+  # taskscpp runs the commands, then monitors until interrupted.  Wait until
+  # it reports that it is monitoring, then stop it with SIGINT so that it
+  # exits normally (which is required to write profile data).
+  local log="$WORK_DIR/round-$round.log"
+  "$TASKSCPP" "${args[@]}" >"$log" 2>&1 &
+  local pid=$!
+  until grep -q "Monitoring tasks for changes" "$log"; do
+    if ! kill -0 "$pid" 2>/dev/null; then
+      echo "error: taskscpp exited early; see output below" >&2
+      cat "$log" >&2
+      return 1
+    fi
+    sleep 0.05
+  done
+  # Give taskscpp time to install its SIGINT handler.
+  sleep 0.2
+  kill -INT "$pid"
+  wait "$pid"
+}
+
+total_ms=0
+for ((round = 1; round <= ROUNDS; round++)); do
+  start=$(now_ms)
+  run_round "$round"
+  elapsed=$(($(now_ms) - start))
+  total_ms=$((total_ms + elapsed))
+  echo "round $round: ${elapsed} ms"
+done
+echo "total: ${total_ms} ms"
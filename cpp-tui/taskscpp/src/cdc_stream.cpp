@@ -0,0 +1,430 @@
+#include "cdc_stream.h"
+#include "tasks_log.h"
+#include "tasks_peer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using json = nlohmann::json;
+
+/// Prefix of a CdcOptions destination that names a Unix domain socket.
+static const string unix_socket_prefix = "unix:";
+
+/// Maximum number of bytes of records gathered into one write.
+static constexpr size_t max_write_bytes = 1 << 20;
+
+void to_json(json &j, const CdcCheckpoint &checkpoint) {
+  j = json{{"seq", checkpoint.seq},
+           {"modified_at", checkpoint.modified_at},
+           {"task_ids", checkpoint.task_ids}};
+}
+
+void from_json(const json &j, CdcCheckpoint &checkpoint) {
+  checkpoint.seq = j.at("seq").get<uint64_t>();
+  checkpoint.modified_at = j.at("modified_at").get<int64_t>();
+  checkpoint.task_ids.clear();
+  if (j.contains("task_ids")) {
+    checkpoint.task_ids = j.at("task_ids").get<vector<string>>();
+  } else if (j.contains("_id")) {
+    // Checkpoints from earlier versions have only the last task's ID.
+    checkpoint.task_ids.push_back(j.at("_id").get<string>());
+  }
+}
+
+static bool is_unix_socket(const string &destination) {
+  return destination.compare(0, unix_socket_prefix.size(),
+                             unix_socket_prefix) == 0;
+}
+
+/// Return the path of a destination, without any "unix:" prefix.
+static string destination_path(const string &destination) {
+  return is_unix_socket(destination)
+             ? destination.substr(unix_socket_prefix.size())
+             : destination;
+}
+
+/// Open a destination for writing, returning its file descriptor.
+static int open_destination(const string &destination) {
+  const auto path = destination_path(destination);
+  if (path.empty()) {
+    throw runtime_error("unable to open CDC destination: no path given");
+  }
+
+  if (!is_unix_socket(destination)) {
+    const int fd =
+        ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      throw runtime_error("unable to open " + path + ": " + strerror(errno));
+    }
+    return fd;
+  }
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw runtime_error("unable to connect to " + path + ": path too long");
+  }
+  memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    throw runtime_error("unable to create socket: " + string(strerror(errno)));
+  }
+#ifdef SO_NOSIGPIPE
+  // Platforms without MSG_NOSIGNAL suppress SIGPIPE per socket instead.
+  const int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+  if (::connect(fd, reinterpret_cast<const sockaddr *>(&address),
+                sizeof(address)) != 0) {
+    const auto err = errno;
+    ::close(fd);
+    throw runtime_error("unable to connect to " + path + ": " + strerror(err));
+  }
+  return fd;
+}
+
+/// Write all of `data` to a file descriptor.
+///
+/// A socket whose reader has gone away is reported as an error rather than
+/// raising SIGPIPE.
+static void write_all(int fd, bool is_socket, const string &data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n;
+    if (is_socket) {
+#ifdef MSG_NOSIGNAL
+      n = ::send(fd, data.data() + written, data.size() - written,
+                 MSG_NOSIGNAL);
+#else
+      n = ::send(fd, data.data() + written, data.size() - written, 0);
+#endif
+    } else {
+      n = ::write(fd, data.data() + written, data.size() - written);
+    }
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw runtime_error("unable to write CDC records: " +
+                          string(strerror(errno)));
+    }
+    written += static_cast<size_t>(n);
+  }
+}
+
+/// Return the kind of change that produced a task's current state.
+///
+/// A task that has not been changed since it was created is reported as an
+/// insert, even if earlier changes to it were not read by the stream.
+static const char *change_op(const Task &task) {
+  if (task.deleted) {
+    return "delete";
+  }
+  if (task.created_at != 0 && task.created_at == task.modified_at) {
+    return "insert";
+  }
+  return "update";
+}
+
+/// Read a checkpoint file, returning an empty checkpoint if it does not
+/// exist.
+static CdcCheckpoint load_checkpoint(const string &path) {
+  ifstream in(path);
+  if (!in) {
+    return {};
+  }
+  try {
+    return json::parse(in).get<CdcCheckpoint>();
+  } catch (const exception &err) {
+    throw runtime_error("unable to read CDC checkpoint " + path + ": " +
+                        err.what());
+  }
+}
+
+CdcStream::CdcStream(TasksPeer &peer, CdcOptions options)
+    : peer(peer), options(std::move(options)),
+      checkpoint_path(this->options.checkpoint_path.empty()
+                          ? destination_path(this->options.destination) +
+                                ".checkpoint"
+                          : this->options.checkpoint_path) {
+  start = load_checkpoint(checkpoint_path);
+  totals.last_seq = start.seq;
+  fd = open_destination(this->options.destination);
+  sync_to_disk = !is_unix_socket(this->options.destination);
+  log_info("Starting CDC stream to " + this->options.destination +
+           " after sequence number " + to_string(start.seq));
+
+  try {
+    // Every change sets `modified_at`, so a change to any task changes the
+    // most recently modified task.  Observing only that one is cheaper than
+    // observing the collection, and is enough to wake the reader.
+    TaskFilter filter;
+    filter.include_deleted = true;
+    observer = peer.observe(filter, TaskSort::RecentlyModified, 1,
+                            [this](const vector<Task> &) {
+                              {
+                                lock_guard<mutex> lock(mtx);
+                                change_observed = true;
+                              }
+                              cv.notify_all();
+                            });
+    writer = thread([this] { write_records(); });
+    reader = thread([this] { read_changes(); });
+  } catch (...) {
+    observer.reset();
+    {
+      lock_guard<mutex> lock(mtx);
+      stopping = true;
+    }
+    cv.notify_all();
+    if (writer.joinable()) {
+      writer.join();
+    }
+    ::close(fd);
+    throw;
+  }
+}
+
+CdcStream::~CdcStream() noexcept { stop(); }
+
+void CdcStream::stop() {
+  if (fd < 0) {
+    return;
+  }
+  observer.reset();
+  {
+    lock_guard<mutex> lock(mtx);
+    stopping = true;
+  }
+  cv.notify_all();
+  // The reader stops first, so that the writer can drain what it queued.
+  if (reader.joinable()) {
+    reader.join();
+  }
+  if (writer.joinable()) {
+    writer.join();
+  }
+  ::close(fd);
+  fd = -1;
+  log_info("Stopped CDC stream to " + options.destination);
+}
+
+bool CdcStream::running() const {
+  lock_guard<mutex> lock(mtx);
+  return error_message.empty();
+}
+
+string CdcStream::error() const {
+  lock_guard<mutex> lock(mtx);
+  return error_message;
+}
+
+CdcStats CdcStream::stats() const {
+  lock_guard<mutex> lock(mtx);
+  return totals;
+}
+
+void CdcStream::fail(const string &message) {
+  log_error("CDC stream stopped: " + message);
+  {
+    lock_guard<mutex> lock(mtx);
+    if (error_message.empty()) {
+      error_message = message;
+    }
+    stopping = true;
+  }
+  cv.notify_all();
+}
+
+bool CdcStream::push(Record record) {
+  const auto capacity = max<size_t>(options.queue_capacity, 1);
+  unique_lock<mutex> lock(mtx);
+  if (!stopping && queue.size() >= capacity) {
+    ++totals.backpressure_waits;
+    cv.wait(lock,
+            [this, capacity] { return stopping || queue.size() < capacity; });
+  }
+  if (stopping) {
+    return false;
+  }
+  queue.push_back(std::move(record));
+  totals.max_queued = max(totals.max_queued, queue.size());
+  if (queue.size() == 1) {
+    cv.notify_all();
+  }
+  return true;
+}
+
+void CdcStream::read_changes() {
+  auto seq = start.seq;
+  auto modified_at = start.modified_at;
+  unordered_set<string> written_ids(start.task_ids.begin(),
+                                    start.task_ids.end());
+  const auto batch_size = max<size_t>(options.batch_size, 1);
+
+  // Each poll reads from `modified_at` again, because a task can be changed
+  // in the same millisecond as the last record but have a lower ID.  Only
+  // within a poll are pages read after the last ID returned.
+  string page_after_id;
+  for (;;) {
+    vector<Task> tasks;
+    try {
+      tasks = peer.get_tasks_modified_since(modified_at, batch_size,
+                                            page_after_id);
+    } catch (const exception &err) {
+      fail(err.what());
+      return;
+    }
+
+    for (const auto &task : tasks) {
+      page_after_id = task._id;
+      if (task.modified_at == modified_at) {
+        if (!written_ids.insert(task._id).second) {
+          continue;
+        }
+      } else {
+        modified_at = task.modified_at;
+        written_ids.clear();
+        written_ids.insert(task._id);
+      }
+
+      ++seq;
+      // Built by hand rather than as a json object, which would sort the
+      // keys, so that `seq` comes first.
+      auto line = "{\"seq\":" + to_string(seq) + ",\"op\":\"" +
+                  change_op(task) + "\",\"_id\":" + json(task._id).dump() +
+                  ",\"doc\":" + json(task).dump() + "}";
+      if (!push({std::move(line), seq, task.modified_at, task._id})) {
+        return;
+      }
+    }
+
+    // A full batch means there may be more changes already in the store.
+    const bool caught_up = tasks.size() < batch_size;
+    if (caught_up) {
+      page_after_id.clear();
+    }
+    unique_lock<mutex> lock(mtx);
+    if (caught_up) {
+      cv.wait_for(lock, options.poll_interval,
+                  [this] { return stopping || change_observed; });
+    }
+    if (stopping) {
+      return;
+    }
+    change_observed = false;
+  }
+}
+
+void CdcStream::write_records() {
+  const bool is_socket = !sync_to_disk;
+  string buffer;
+  auto written = start;
+  bool checkpoint_pending = false;
+  auto last_checkpoint_time = chrono::steady_clock::now();
+
+  unique_lock<mutex> lock(mtx);
+  for (;;) {
+    cv.wait_for(lock, options.checkpoint_interval,
+                [this] { return stopping || !queue.empty(); });
+    if (!error_message.empty() || (stopping && queue.empty())) {
+      break;
+    }
+
+    // Gather the queued records into one write, which leaves room in the
+    // queue for the reader while the write is in progress.
+    buffer.clear();
+    size_t count = 0;
+    while (!queue.empty() && buffer.size() < max_write_bytes) {
+      auto &record = queue.front();
+      buffer += record.line;
+      buffer += '\n';
+      written.seq = record.seq;
+      if (record.modified_at != written.modified_at) {
+        written.modified_at = record.modified_at;
+        written.task_ids.clear();
+      }
+      written.task_ids.push_back(std::move(record.task_id));
+      queue.pop_front();
+      ++count;
+    }
+    cv.notify_all();
+
+    const auto now = chrono::steady_clock::now();
+    const bool save_now =
+        (checkpoint_pending || count > 0) &&
+        now - last_checkpoint_time >= options.checkpoint_interval;
+    lock.unlock();
+    try {
+      if (count > 0) {
+        write_all(fd, is_socket, buffer);
+        checkpoint_pending = true;
+      }
+      if (save_now) {
+        save_checkpoint(written);
+        checkpoint_pending = false;
+        last_checkpoint_time = now;
+      }
+    } catch (const exception &err) {
+      fail(err.what());
+      lock.lock();
+      break;
+    }
+    lock.lock();
+
+    if (count > 0) {
+      totals.records_written += count;
+      ++totals.writes;
+      totals.last_seq = written.seq;
+    }
+  }
+  lock.unlock();
+
+  if (checkpoint_pending) {
+    try {
+      save_checkpoint(written);
+    } catch (const exception &err) {
+      log_error("Failed to save CDC checkpoint: " + string(err.what()));
+    }
+  }
+}
+
+void CdcStream::save_checkpoint(const CdcCheckpoint &checkpoint) {
+  // The records must reach the disk before a checkpoint that covers them, or
+  // a crash could lose records that would not be written again.
+  if (sync_to_disk && ::fsync(fd) != 0) {
+    throw runtime_error("unable to sync CDC records: " +
+                        string(strerror(errno)));
+  }
+
+  // Replace the checkpoint file atomically, so that it is never seen partly
+  // written.
+  const auto temp_path = checkpoint_path + ".tmp";
+  {
+    ofstream out(temp_path, ios::trunc);
+    out << json(checkpoint).dump() << '\n';
+    out.flush();
+    if (!out) {
+      throw runtime_error("unable to write " + temp_path);
+    }
+  }
+  if (rename(temp_path.c_str(), checkpoint_path.c_str()) != 0) {
+    throw runtime_error("unable to replace " + checkpoint_path + ": " +
+                        strerror(errno));
+  }
+}
@@ -0,0 +1,189 @@
+#ifndef DITTO_QUICKSTART_CDC_STREAM_H
+#define DITTO_QUICKSTART_CDC_STREAM_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Ditto.h"
+
+class TasksPeer;
+
+/// Position in a CdcStream, persisted so that a restarted stream resumes
+/// after the last record it wrote.
+struct CdcCheckpoint {
+  /// Sequence number of the last record written, or 0 if none has been.
+  std::uint64_t seq = 0;
+
+  /// `modified_at` of the task in the last record written.
+  std::int64_t modified_at = 0;
+
+  /// IDs of the tasks with that `modified_at` whose records have been
+  /// written, which are skipped when the stream reads from that time again.
+  std::vector<std::string> task_ids;
+};
+
+/// Copies data from a CdcCheckpoint to a JSON object.
+void to_json(nlohmann::json &j, const CdcCheckpoint &checkpoint);
+
+/// Copies data from a JSON object to a CdcCheckpoint.
+void from_json(const nlohmann::json &j, CdcCheckpoint &checkpoint);
+
+/// Configuration of a CdcStream.
+struct CdcOptions {
+  /// File to which records are appended, or "unix:PATH" to write them to a
+  /// Unix domain socket that another process is listening on.
+  std::string destination;
+
+  /// File in which the checkpoint is kept.  If empty, it is the destination
+  /// path with ".checkpoint" appended.
+  std::string checkpoint_path;
+
+  /// Maximum number of records held in memory between reading them from the
+  /// store and writing them to the destination.
+  std::size_t queue_capacity = 10000;
+
+  /// Maximum number of tasks read from the store by each query.
+  std::size_t batch_size = 1000;
+
+  /// Minimum time between checkpoint writes.  On restart, records written
+  /// after the last checkpoint are written again.
+  std::chrono::milliseconds checkpoint_interval{1000};
+
+  /// Interval at which the store is read even if no change has been
+  /// observed, to pick up changes synced from peers whose clocks are behind.
+  std::chrono::milliseconds poll_interval{1000};
+};
+
+/// Cumulative statistics from a CdcStream.
+struct CdcStats {
+  /// Number of records written to the destination.
+  std::uint64_t records_written = 0;
+
+  /// Number of writes to the destination, each of one or more records.
+  std::uint64_t writes = 0;
+
+  /// Number of times reading from the store waited because the queue was
+  /// full, which means the destination is slower than the rate of changes.
+  std::uint64_t backpressure_waits = 0;
+
+  /// Largest number of records that have been queued at once.
+  std::size_t max_queued = 0;
+
+  /// Sequence number of the last record written.
+  std::uint64_t last_seq = 0;
+};
+
+/// Writes a change-data-capture ("CDC") stream of the tasks collection: one
+/// line of JSON for each changed task, in `modified_at` order, of the form
+///
+///     {"seq":N,"op":"insert|update|delete","_id":"...","doc":{...}}
+///
+/// where `doc` is the task after the change.  Sequence numbers increase by
+/// one per record, and continue from the checkpoint when a stream is
+/// restarted.
+///
+/// Tasks are read with `TasksPeer::get_tasks_modified_since()`, so each read
+/// costs in proportion to the number of changes, not the size of the
+/// collection.  Reading and writing run on separate background threads
+/// connected by a bounded queue: when the destination falls behind, reading
+/// waits rather than buffering without limit, and resumes from the store
+/// once there is room, so no change is lost.
+///
+/// Each read starts again from the `modified_at` of the last record, rather
+/// than after its ID, and skips the tasks with that time that have already
+/// been written.  So a task changed later, in the same millisecond as the
+/// last record, is not missed because its ID sorts before the last one.
+///
+/// Delivery is at least once.  Records are written before the checkpoint
+/// that covers them, so after a crash some records may be written again.
+/// A task changed several times before it is read produces one record with
+/// its latest state, as does a task changed twice in the same millisecond.
+/// As described for `get_tasks_modified_since()`, a change synced from a
+/// peer whose clock is behind the checkpoint is not delivered.
+///
+/// Evictions, such as those made by the retention policy or by `--cleanup`,
+/// remove tasks from the local store without changing them, so they never
+/// produce records.  A consumer sees a deleted task's `delete` record only
+/// if the stream read the task before it was evicted.
+class CdcStream {
+public:
+  /// Open the destination, read the checkpoint, and start the background
+  /// threads.
+  ///
+  /// @throws std::runtime_error if the destination cannot be opened or the
+  /// checkpoint cannot be read.
+  CdcStream(TasksPeer &peer, CdcOptions options);
+
+  /// Stop the stream, as `stop()` does.
+  ~CdcStream() noexcept;
+
+  CdcStream(const CdcStream &) = delete;
+  CdcStream(CdcStream &&) = delete;
+
+  CdcStream &operator=(const CdcStream &) = delete;
+  CdcStream &operator=(CdcStream &&) = delete;
+
+  /// Stop the background threads, write the records that have been queued,
+  /// and save the checkpoint.  Calling this more than once has no effect.
+  void stop();
+
+  /// Return false if the stream has stopped because of an error.
+  bool running() const;
+
+  /// Return a description of the error that stopped the stream, or an empty
+  /// string if there has been none.
+  std::string error() const;
+
+  /// Return a copy of the statistics collected so far.
+  CdcStats stats() const;
+
+private:
+  struct Record {
+    std::string line;
+    std::uint64_t seq;
+    std::int64_t modified_at;
+    std::string task_id;
+  };
+
+  void read_changes();
+  void write_records();
+
+  /// Add a record to the queue, waiting while it is full.
+  ///
+  /// @return false if the stream is stopping.
+  bool push(Record record);
+
+  /// Set the error that stops the stream.
+  void fail(const std::string &message);
+
+  void save_checkpoint(const CdcCheckpoint &checkpoint);
+
+  TasksPeer &peer;
+  const CdcOptions options;
+  const std::string checkpoint_path;
+  CdcCheckpoint start; // position read from the checkpoint file
+  int fd = -1; // closed by stop()
+  bool sync_to_disk = false; // true if the destination is a file
+
+  mutable std::mutex mtx; // guards the members below
+  std::condition_variable cv;
+  std::deque<Record> queue;
+  bool change_observed = false;
+  bool stopping = false;
+  std::string error_message;
+  CdcStats totals;
+
+  std::shared_ptr<ditto::StoreObserver> observer;
+  std::thread writer;
+  std::thread reader;
+};
+
+#endif // DITTO_QUICKSTART_CDC_STREAM_H
@@ -1,5 +1,6 @@
 #include "env.h"
 
+#include "cdc_stream.h"
 #include "task.h"
 #include "tasks_log.h"
 #include "tasks_peer.h"
@@ -16,16 +17,22 @@
 #include "cxxopts.hpp"
 
 #include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <csignal>
 #include <cstdlib>
 #include <exception>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
 #include <vector>
 
 using namespace std;
+using json = nlohmann::json;
 
 // Flag set if Ctrl+C is pressed
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
@@ -51,6 +58,225 @@ static void validate_task_substring(const string &task_id_substring) {
   }
 }
 
+/// Sync subscriptions selected by the --subscribe options.
+struct SubscriptionOptions {
+  /// Queries with a fixed scope.
+  vector<string> queries;
+
+  /// The age of the sliding window of recently modified tasks, if any.
+  optional<chrono::seconds> recent;
+
+  bool empty() const { return queries.empty() && !recent; }
+};
+
+/// Build the sync subscriptions from the --subscribe options.
+///
+/// @return empty options if no subscriptions were specified.
+static SubscriptionOptions
+subscriptions_from(const cxxopts::ParseResult &opt_parse) {
+  SubscriptionOptions subscriptions;
+  auto &queries = subscriptions.queries;
+  if (opt_parse.count("subscribe") > 0) {
+    for (const auto &scope : opt_parse["subscribe"].as<vector<string>>()) {
+      if (scope == "all") {
+        queries.push_back(TasksPeer::subscription_query_all());
+      } else if (scope == "active") {
+        queries.push_back(TasksPeer::subscription_query_active());
+      } else if (scope == "recent") {
+        const auto days = opt_parse["subscribe-days"].as<unsigned>();
+        subscriptions.recent = chrono::hours(24) * days;
+      } else {
+        throw invalid_argument("unknown subscription scope: " + scope);
+      }
+    }
+  }
+  if (opt_parse.count("subscribe-query") > 0) {
+    for (const auto &query :
+         opt_parse["subscribe-query"].as<vector<string>>()) {
+      queries.push_back(query);
+    }
+  }
+  return subscriptions;
+}
+
+/// Check that the --retain-* options do not evict tasks that a sync
+/// subscription from the --subscribe options would sync again at once, which
+/// would evict and resync the same tasks over and over.
+///
+/// Combinations that always do that are rejected.  Those that may, depending
+/// on the tasks' ages or on a --subscribe-query, are reported on `warnings`.
+static void check_retention_scope(const RetentionPolicy &policy,
+                                  const cxxopts::ParseResult &opt_parse,
+                                  ostream &warnings) {
+  if (!policy.enabled()) {
+    return;
+  }
+  const bool evicts_by_count =
+      policy.max_completed_tasks.has_value() || policy.max_documents.has_value();
+
+  vector<string> scopes;
+  if (opt_parse.count("subscribe") > 0) {
+    scopes = opt_parse["subscribe"].as<vector<string>>();
+  } else if (opt_parse.count("subscribe-query") == 0) {
+    scopes.push_back("all");
+  }
+  for (const auto &scope : scopes) {
+    if (scope == "all") {
+      throw invalid_argument(
+          "--retain-* evicts tasks that --subscribe all (the default) syncs "
+          "again; use --subscribe active or recent");
+    } else if (scope == "active" && evicts_by_count) {
+      throw invalid_argument(
+          "--retain-completed and --retain-max-docs evict tasks that "
+          "--subscribe active syncs again; use --subscribe recent");
+    } else if (scope == "recent") {
+      const auto window =
+          chrono::hours(24) * opt_parse["subscribe-days"].as<unsigned>();
+      if (policy.tombstone_max_age && *policy.tombstone_max_age < window) {
+        throw invalid_argument(
+            "--retain-tombstones must be at least --subscribe-days, or "
+            "--subscribe recent syncs evicted deleted tasks again");
+      }
+      if (evicts_by_count) {
+        warnings << "warning: --retain-completed and --retain-max-docs may "
+                    "evict tasks modified in the last "
+                 << opt_parse["subscribe-days"].as<unsigned>()
+                 << " days, which --subscribe recent syncs again" << endl;
+      }
+    }
+  }
+  if (opt_parse.count("subscribe-query") > 0) {
+    warnings << "warning: tasks evicted by --retain-* are synced again if "
+                "they match --subscribe-query"
+             << endl;
+  }
+}
+
+/// Build the filter for --monitor from the --monitor-status and
+/// --monitor-title options.
+static TaskFilter monitor_filter_from(const cxxopts::ParseResult &opt_parse) {
+  TaskFilter filter;
+  const auto status = opt_parse["monitor-status"].as<string>();
+  if (status == "open") {
+    filter.done = false;
+  } else if (status == "done") {
+    filter.done = true;
+  } else if (status != "all") {
+    throw invalid_argument("--monitor-status must be all, open, or done");
+  }
+  if (opt_parse.count("monitor-title") > 0) {
+    filter.title_contains = opt_parse["monitor-title"].as<string>();
+  }
+  return filter;
+}
+
+/// Parse the --monitor-sort option.
+static TaskSort monitor_sort_from(const cxxopts::ParseResult &opt_parse) {
+  const auto order = opt_parse["monitor-sort"].as<string>();
+  if (order == "id") {
+    return TaskSort::Id;
+  } else if (order == "title") {
+    return TaskSort::Title;
+  } else if (order == "recent") {
+    return TaskSort::RecentlyModified;
+  }
+  throw invalid_argument("--monitor-sort must be id, title, or recent");
+}
+
+/// Fetch the body of a task, writing it to `path`, or to stdout if `path` is
+/// empty, and reporting progress on stderr unless `quiet` is set.
+///
+/// Waits until the whole body has been fetched, or Ctrl+C is pressed.
+static void fetch_body_to(TasksPeer &peer, const string &task_id,
+                          const string &path, bool quiet) {
+  // Shared with the handlers, which may still be called after a canceled
+  // fetch returns.
+  struct FetchState {
+    mutex mtx;
+    condition_variable cv;
+    bool finished = false;
+    string error;
+  };
+  auto state = make_shared<FetchState>();
+  const auto finish = [state](string error) {
+    lock_guard<mutex> lock(state->mtx);
+    state->finished = true;
+    state->error = std::move(error);
+    state->cv.notify_all();
+  };
+
+  TaskBodyFetchHandlers handlers;
+  if (!quiet) {
+    handlers.on_progress = [](uint64_t fetched_bytes, uint64_t total_bytes) {
+      cerr << "\rFetched " << fetched_bytes << " of " << total_bytes
+           << " bytes" << flush;
+    };
+  }
+  handlers.on_complete = [finish, path](const ditto::Attachment &body) {
+    try {
+      if (!path.empty()) {
+        body.copy_to_path(path);
+      } else {
+        // Copy through a temporary file, so that a large body is never held
+        // in memory.
+        const auto temp_path =
+            filesystem::temp_directory_path() / ("taskscpp_body_" + body.id());
+        body.copy_to_path(temp_path.string());
+        {
+          ifstream in(temp_path, ios::binary);
+          cout << in.rdbuf();
+          cout.flush();
+        }
+        filesystem::remove(temp_path);
+      }
+      finish("");
+    } catch (const exception &err) {
+      finish(err.what());
+    }
+  };
+  handlers.on_deleted = [finish] { finish("the body has been deleted"); };
+
+  signal(SIGINT, taskscli_main_sigint_handler);
+  const auto fetcher = peer.fetch_task_body(task_id, std::move(handlers));
+  {
+    unique_lock<mutex> lock(state->mtx);
+    while (!state->finished && sigint_caught == 0) {
+      state->cv.wait_for(lock, chrono::milliseconds(200));
+    }
+  }
+  signal(SIGINT, SIG_DFL);
+
+  lock_guard<mutex> lock(state->mtx);
+  if (!state->finished) {
+    fetcher->stop();
+    throw runtime_error("fetch canceled");
+  }
+  if (!quiet) {
+    cerr << endl;
+  }
+  if (!state->error.empty()) {
+    throw runtime_error(state->error);
+  }
+}
+
+/// Return the path of the file in which --storage-report keeps the previous
+/// report, or an empty string if there is none.
+static string storage_report_state_path(const cxxopts::ParseResult &opt_parse,
+                                        const string &persistence_dir) {
+  if (opt_parse.count("storage-report-state") > 0) {
+    return opt_parse["storage-report-state"].as<string>();
+  }
+  if (persistence_dir.empty()) {
+    return "";
+  }
+  auto path = filesystem::path(persistence_dir);
+  if (!path.has_filename()) {
+    path = path.parent_path(); // remove trailing separator
+  }
+  path += ".storage-report.json";
+  return path.string();
+}
+
 int main(int argc, const char *argv[]) {
   std::string export_log_path;
 
@@ -62,7 +288,10 @@ int main(int argc, const char *argv[]) {
     options.add_options("Command")
       ("h,help", "Print usage")
 #ifdef DITTO_QUICKSTART_TUI
-      ("tui", "Run the text-based user interface (default)")
+      ("tui",
+        "Run the text-based user interface (default); while it is shown, an "
+        "observer that reads every task on each change keeps the task counts "
+        "in its status bar up to date")
 #endif
       ("a,add", "Add a new task",
         cxxopts::value<vector<string>>(), "TITLE")
@@ -76,12 +305,68 @@ int main(int argc, const char *argv[]) {
         cxxopts::value<vector<string>>(), "TASK_ID,TITLE")
       ("d,delete", "Delete a task",
         cxxopts::value<vector<string>>(), "TASK_ID")
+      ("attach", "Attach the contents of a file to a task as its body",
+        cxxopts::value<vector<string>>(), "TASK_ID,PATH")
+      ("fetch", "Fetch the body of a task into a file, or to stdout if no "
+        "PATH is given",
+        cxxopts::value<vector<string>>(), "TASK_ID[,PATH]")
       ("l,list", "List tasks")
       ("list-all", "List all tasks, including those marked deleted")
+      ("since",
+        "List tasks changed at or after a time, in milliseconds since the "
+        "Unix epoch, including deleted tasks",
+        cxxopts::value<int64_t>(), "MS")
+      ("since-limit", "Maximum number of tasks listed by --since",
+        cxxopts::value<size_t>()->default_value("1000"), "N")
+      ("count",
+        "Print the number of open, done and deleted tasks, counted once with "
+        "COUNT queries")
+      ("storage-report",
+        "Print a JSON report of the storage used by the peer, including the "
+        "growth since the previous report")
+      ("storage-report-state",
+        "File in which --storage-report keeps the previous report (default: "
+        "next to the persistence directory)",
+        cxxopts::value<string>(), "PATH")
+      ("storage-sample",
+        "Maximum number of documents whose sizes --storage-report measures; "
+        "beyond this, only the first N in store order are measured",
+        cxxopts::value<size_t>()->default_value("10000"), "N")
       ("m,monitor", "Monitor tasks for changes")
       ("cleanup", "Evict all deleted tasks from local store")
       ("query", "Run a DQL query using the peer's Ditto instance",
-        cxxopts::value<vector<string>>(), "STRING");
+        cxxopts::value<vector<string>>(), "STRING")
+      ("explain", "Print the query plan for a DQL query",
+        cxxopts::value<vector<string>>(), "STRING")
+      ("format", "Output format for --query and --since results: json (one "
+        "document) or ndjson (one line per item, streamed)",
+        cxxopts::value<string>()->default_value("json"), "FORMAT");
+
+    options.add_options("Monitor")
+      ("monitor-status",
+        "Tasks shown by --monitor: all (default), open, or done",
+        cxxopts::value<string>()->default_value("all"), "STATUS")
+      ("monitor-title", "Show only tasks whose title contains STRING",
+        cxxopts::value<string>(), "STRING")
+      ("monitor-sort",
+        "Order of tasks shown by --monitor: id (default), title, or recent",
+        cxxopts::value<string>()->default_value("id"), "ORDER")
+      ("monitor-limit", "Maximum number of tasks shown by --monitor",
+        cxxopts::value<unsigned>(), "N");
+
+    options.add_options("CDC")
+      ("cdc",
+        "Stream changed tasks as NDJSON records to a file, or to a Unix "
+        "socket given as unix:PATH, until Ctrl+C is pressed",
+        cxxopts::value<string>(), "TARGET")
+      ("cdc-checkpoint",
+        "File in which --cdc keeps its position, so that a restart resumes "
+        "where it stopped (default: TARGET's path with .checkpoint appended)",
+        cxxopts::value<string>(), "PATH")
+      ("cdc-queue",
+        "Maximum number of records --cdc holds in memory before reading "
+        "waits for the target to catch up",
+        cxxopts::value<size_t>()->default_value("10000"), "N");
 
     options.add_options("Sync")
       ("pre", "Number of seconds to synchronize before the operation",
@@ -98,7 +383,60 @@ int main(int argc, const char *argv[]) {
         cxxopts::value<string>(), "WEBSOCKET_URL")
       ("auth-url", "Ditto Auth URL",
         cxxopts::value<string>(), "AUTH_URL")
-      ("enable-cloud-sync", "Enable cloud synchronization");
+      ("enable-cloud-sync", "Enable cloud synchronization")
+      ("transport",
+        "Transport profile: default (all peer-to-peer and WebSocket), lan, "
+        "tcp (only --tcp-listen and --tcp-connect), p2p, or cloud",
+        cxxopts::value<string>()->default_value("default"), "PROFILE")
+      ("tcp-listen", "Accept TCP connections from other peers at this address",
+        cxxopts::value<string>(), "HOST:PORT")
+      ("tcp-connect", "Connect to a peer over TCP; may be repeated",
+        cxxopts::value<vector<string>>(), "HOST:PORT")
+      ("offline-identity",
+        "Use an offline playground identity, which needs no network access "
+        "to authenticate, instead of the online playground")
+      ("offline-license-token", "License token for --offline-identity",
+        cxxopts::value<string>(), "TOKEN")
+      ("subscribe",
+        "Scope of tasks synced from other peers: all (default), active, or "
+        "recent; may be repeated",
+        cxxopts::value<vector<string>>(), "SCOPE")
+      ("subscribe-days",
+        "Number of days covered by the recent scope, which slides forward",
+        cxxopts::value<unsigned>()->default_value("7"), "N")
+      ("subscribe-query", "DQL query for an additional sync subscription",
+        cxxopts::value<vector<string>>(), "STRING")
+      ("write-behind-ms",
+        "Coalesce changes to each task for up to MS milliseconds, and write "
+        "them in groups (0 writes each change immediately)",
+        cxxopts::value<unsigned>()->default_value("0"), "MS");
+
+    options.add_options("Retention")
+      ("retain-tombstones",
+        "Evict deleted tasks in the background once they have not been "
+        "modified for N seconds",
+        cxxopts::value<unsigned>(), "N")
+      ("retain-completed",
+        "Keep at most N completed tasks, evicting the oldest in the background",
+        cxxopts::value<unsigned>(), "N")
+      ("retain-max-docs",
+        "Keep at most N documents in the local store, evicting deleted and "
+        "then the oldest tasks in the background",
+        cxxopts::value<unsigned>(), "N")
+      ("retention-batch", "Maximum number of tasks evicted per batch",
+        cxxopts::value<unsigned>()->default_value("100"), "N")
+      ("retention-interval-ms", "Time between eviction batches",
+        cxxopts::value<unsigned>()->default_value("200"), "MS");
+
+#ifdef DITTO_QUICKSTART_TUI
+    options.add_options("TUI")
+      ("tui-max-fps", "Maximum number of task list refreshes per second",
+        cxxopts::value<unsigned>()->default_value("30"), "N")
+      ("tui-frame-budget-ms",
+        "Time allowed for applying a task list refresh before further "
+        "refreshes are deferred",
+        cxxopts::value<unsigned>()->default_value("8"), "MS");
+#endif
 
     options.add_options("Logging")
       ("q,quiet", "Disable non-logging output")
@@ -120,7 +458,10 @@ int main(int argc, const char *argv[]) {
     const vector<string> commands{"add",      "complete", "incomplete",
                                   "title",    "delete",   "list",
                                   "list-all", "monitor",  "cleanup",
-                                  "query",    "toggle",   "ditto-sdk-version"};
+                                  "query",    "explain",  "toggle",
+                                  "count",    "storage-report",
+                                  "attach",   "fetch",    "since",
+                                  "cdc",      "ditto-sdk-version"};
     bool found_non_tui_command = false;
     for (const auto &command : commands) {
       if (opt_parse.count(command) > 0) {
@@ -201,9 +542,97 @@ int main(int argc, const char *argv[]) {
             : DITTO_AUTH_URL;
 
     const auto enable_cloud_sync = opt_parse.count("enable-cloud-sync") > 0;
+    const auto subscriptions = subscriptions_from(opt_parse);
+
+    TransportOptions transport_options;
+    transport_options.profile =
+        parse_transport_profile(opt_parse["transport"].as<string>());
+    if (opt_parse.count("tcp-listen") > 0) {
+      parse_tcp_listen_address(opt_parse["tcp-listen"].as<string>(),
+                               transport_options);
+    }
+    if (opt_parse.count("tcp-connect") > 0) {
+      transport_options.tcp_connect_addresses =
+          opt_parse["tcp-connect"].as<vector<string>>();
+    }
+    transport_options.offline_identity =
+        opt_parse.count("offline-identity") > 0;
+    if (opt_parse.count("offline-license-token") > 0) {
+      transport_options.offline_license_token =
+          opt_parse["offline-license-token"].as<string>();
+    }
+    if (transport_options.offline_identity &&
+        (enable_cloud_sync ||
+         transport_options.profile == TransportProfile::Cloud)) {
+      throw invalid_argument(
+          "--offline-identity cannot be used with cloud sync");
+    }
+    if (transport_options.profile == TransportProfile::Tcp &&
+        transport_options.tcp_listen_address.empty() &&
+        transport_options.tcp_connect_addresses.empty()) {
+      throw invalid_argument(
+          "--transport tcp requires --tcp-listen or --tcp-connect");
+    }
 
     const auto quiet = opt_parse["quiet"].as<bool>();
 
+    const auto monitor_filter = monitor_filter_from(opt_parse);
+    const auto monitor_sort = monitor_sort_from(opt_parse);
+    const size_t monitor_limit =
+        opt_parse.count("monitor-limit") > 0
+            ? opt_parse["monitor-limit"].as<unsigned>()
+            : 0;
+
+    RetentionPolicy retention_policy;
+    if (opt_parse.count("retain-tombstones") > 0) {
+      retention_policy.tombstone_max_age =
+          chrono::seconds(opt_parse["retain-tombstones"].as<unsigned>());
+    }
+    if (opt_parse.count("retain-completed") > 0) {
+      retention_policy.max_completed_tasks =
+          opt_parse["retain-completed"].as<unsigned>();
+    }
+    if (opt_parse.count("retain-max-docs") > 0) {
+      retention_policy.max_documents =
+          opt_parse["retain-max-docs"].as<unsigned>();
+    }
+    retention_policy.batch_size = opt_parse["retention-batch"].as<unsigned>();
+    retention_policy.batch_interval = chrono::milliseconds(
+        opt_parse["retention-interval-ms"].as<unsigned>());
+    check_retention_scope(retention_policy, opt_parse, cerr);
+
+    const auto write_behind =
+        chrono::milliseconds(opt_parse["write-behind-ms"].as<unsigned>());
+#ifdef DITTO_QUICKSTART_TUI
+    if ((found_tui_command || !found_non_tui_command) &&
+        write_behind > TasksTuiOptions::max_write_behind) {
+      throw invalid_argument(
+          "--write-behind-ms must be at most " +
+          to_string(TasksTuiOptions::max_write_behind.count()) +
+          " in the TUI");
+    }
+#endif
+
+    const auto query_format = opt_parse["format"].as<string>();
+    if (query_format != "json" && query_format != "ndjson") {
+      throw invalid_argument("--format must be json or ndjson");
+    }
+    const auto ndjson = query_format == "ndjson";
+
+    // With NDJSON output or a storage report, stdout carries only JSON, and
+    // when a task body is fetched to stdout, it carries only the body, so
+    // that it can be piped to other tools.  Progress messages go to stderr
+    // instead.
+    const auto storage_report = opt_parse.count("storage-report") > 0;
+    bool fetch_to_stdout = false;
+    if (opt_parse.count("fetch") > 0) {
+      for (const auto &arg : opt_parse["fetch"].as<vector<string>>()) {
+        fetch_to_stdout |= arg.find(',') == string::npos;
+      }
+    }
+    ostream &status_out =
+        (ndjson || storage_report || fetch_to_stdout) ? cerr : cout;
+
     // Set this true if we make modifications and need to allow post-sync time.
     bool need_post_sync = false;
 
@@ -215,13 +644,28 @@ int main(int argc, const char *argv[]) {
         websocket_url,
         auth_url,
         enable_cloud_sync,
-        persistence_dir);
+        persistence_dir,
+        transport_options);
       peer.insert_initial_tasks();
+      if (retention_policy.enabled()) {
+        peer.set_retention_policy(retention_policy);
+      }
+      if (write_behind.count() > 0) {
+        peer.set_write_behind(write_behind);
+      }
+      if (!subscriptions.empty()) {
+        peer.set_subscriptions(subscriptions.queries, subscriptions.recent);
+      }
       peer.start_sync();
 
 #ifdef DITTO_QUICKSTART_TUI
       if (found_tui_command || !found_non_tui_command) {
-        TasksTui tui(peer);
+        TasksTuiOptions tui_options;
+        tui_options.max_refresh_hz = opt_parse["tui-max-fps"].as<unsigned>();
+        tui_options.frame_budget = chrono::milliseconds(
+            opt_parse["tui-frame-budget-ms"].as<unsigned>());
+        tui_options.write_behind = write_behind;
+        TasksTui tui(peer, tui_options);
         tui.run();
       } else
 #endif
@@ -231,7 +675,8 @@ int main(int argc, const char *argv[]) {
 
         shared_ptr<ditto::StoreObserver> tasks_observer;
         if (opt_parse.count("monitor") > 0) {
-          tasks_observer = peer.register_tasks_observer(
+          tasks_observer = peer.observe(
+              monitor_filter, monitor_sort, monitor_limit,
               [quiet, &mtx](const vector<Task> &tasks) {
                 if (!quiet && !tasks.empty()) {
                   lock_guard<mutex> lock(mtx);
@@ -248,7 +693,7 @@ int main(int argc, const char *argv[]) {
         // Allow initial synchronization in background.
         if (pre_sync_sec > 0) {
           if (!quiet) {
-            cout << "Synchronizing tasks..." << endl;
+            status_out << "Synchronizing tasks..." << endl;
           }
           this_thread::sleep_for(chrono::seconds(pre_sync_sec));
         }
@@ -324,10 +769,11 @@ int main(int argc, const char *argv[]) {
 
               lock_guard<mutex> lock(mtx);
               const auto task = peer.find_matching_task(task_id_substring);
-              peer.mark_task_complete(task._id, !task.done);
+              const auto done = peer.toggle_task(task._id);
 
               if (!quiet) {
-                cout << "Toggled task completion: " << task._id << endl;
+                cout << "Toggled task completion: " << task._id
+                     << (done ? " (complete)" : " (incomplete)") << endl;
               }
             } catch (const exception &err) {
               cerr << "error: toggle " << task_id_substring << ": "
@@ -369,6 +815,59 @@ int main(int argc, const char *argv[]) {
           }
         }
 
+        if (opt_parse.count("attach") > 0) {
+          need_post_sync = true;
+          for (const auto &arg : opt_parse["attach"].as<vector<string>>()) {
+            try {
+              const auto comma_pos = arg.find(',');
+              if (comma_pos == string::npos) {
+                throw invalid_argument(
+                    "Argument must be of the form 'TASK_ID,PATH'");
+              }
+
+              const auto task_id_substring = arg.substr(0, comma_pos);
+              validate_task_substring(task_id_substring);
+              const auto path = arg.substr(comma_pos + 1);
+
+              lock_guard<mutex> lock(mtx);
+              const auto task = peer.find_matching_task(task_id_substring);
+              if (!quiet) {
+                cout << "Attaching " << path << " to " << task._id << "..."
+                     << endl;
+              }
+              const auto size = peer.attach_task_body(task._id, path);
+              if (!quiet) {
+                cout << "Attached " << size << " bytes to " << task._id
+                     << endl;
+              }
+            } catch (const exception &err) {
+              cerr << "error: attach " << arg << ": " << err.what() << endl;
+            }
+          }
+        }
+
+        if (opt_parse.count("fetch") > 0) {
+          for (const auto &arg : opt_parse["fetch"].as<vector<string>>()) {
+            try {
+              const auto comma_pos = arg.find(',');
+              const auto task_id_substring = arg.substr(0, comma_pos);
+              validate_task_substring(task_id_substring);
+              const auto path =
+                  comma_pos == string::npos ? "" : arg.substr(comma_pos + 1);
+
+              lock_guard<mutex> lock(mtx);
+              const auto task = peer.find_matching_task(task_id_substring);
+              fetch_body_to(peer, task._id, path, quiet);
+              if (!quiet && !path.empty()) {
+                cout << "Wrote body of " << task._id << " to " << path
+                     << endl;
+              }
+            } catch (const exception &err) {
+              cerr << "error: fetch " << arg << ": " << err.what() << endl;
+            }
+          }
+        }
+
         if (opt_parse.count("delete") > 0) {
           need_post_sync = true;
           for (const auto &task_id_substring :
@@ -408,9 +907,19 @@ int main(int argc, const char *argv[]) {
           for (const auto &query : opt_parse["query"].as<vector<string>>()) {
             try {
               lock_guard<mutex> lock(mtx);
-              const auto result = peer.execute_dql_query(query);
-              if (!quiet) {
-                cout << "[" << query << "] result: \n" << result << endl;
+              if (ndjson) {
+                peer.execute_dql_query_streaming(
+                    query, [quiet](const ditto::QueryResultItem &item) {
+                      if (!quiet) {
+                        cout << item.json_string() << '\n';
+                      }
+                    });
+                cout.flush();
+              } else {
+                const auto result = peer.execute_dql_query(query);
+                if (!quiet) {
+                  cout << "[" << query << "] result: \n" << result << endl;
+                }
               }
             } catch (const exception &err) {
               cerr << "error: query [" << query << "]: " << err.what() << endl;
@@ -418,6 +927,21 @@ int main(int argc, const char *argv[]) {
           }
         }
 
+        if (opt_parse.count("explain") > 0) {
+          for (const auto &query : opt_parse["explain"].as<vector<string>>()) {
+            try {
+              lock_guard<mutex> lock(mtx);
+              const auto plan = peer.explain_query(query);
+              if (!quiet) {
+                cout << "[" << query << "] plan: \n" << plan << endl;
+              }
+            } catch (const exception &err) {
+              cerr << "error: explain [" << query << "]: " << err.what()
+                   << endl;
+            }
+          }
+        }
+
         auto include_deleted_tasks = opt_parse.count("list-all") > 0;
         if (opt_parse.count("list") > 0 || opt_parse.count("list-all") > 0) {
           lock_guard<mutex> lock(mtx);
@@ -430,13 +954,106 @@ int main(int argc, const char *argv[]) {
             if (!quiet) {
               for (const auto &task : tasks) {
                 cout << task._id << " | " << (task.done ? "X" : "O") << " | "
-                     << task.title << (task.deleted ? " (deleted)" : "")
-                     << endl;
+                     << task.title << (task.deleted ? " (deleted)" : "");
+                if (task.body_size > 0) {
+                  cout << " (body: " << task.body_size << " bytes)";
+                }
+                cout << endl;
               }
             }
           }
         }
 
+        if (opt_parse.count("since") > 0 && !quiet) {
+          lock_guard<mutex> lock(mtx);
+          const auto tasks = peer.get_tasks_modified_since(
+              opt_parse["since"].as<int64_t>(),
+              opt_parse["since-limit"].as<size_t>());
+          if (ndjson) {
+            for (const auto &task : tasks) {
+              cout << json(task).dump() << '\n';
+            }
+            cout.flush();
+          } else {
+            json items = json::array();
+            for (const auto &task : tasks) {
+              items.push_back(task);
+            }
+            cout << json{{"items", items}}.dump(2) << endl;
+          }
+        }
+
+        if (opt_parse.count("count") > 0 && !quiet) {
+          lock_guard<mutex> lock(mtx);
+          const auto stats = peer.count_tasks();
+          cout << "open: " << stats.open << endl
+               << "done: " << stats.done << endl
+               << "deleted: " << stats.deleted << endl
+               << "total: " << stats.total() << endl
+               << "tombstone ratio: " << stats.tombstone_ratio() << endl;
+        }
+
+        if (storage_report) {
+          lock_guard<mutex> lock(mtx);
+          auto report =
+              peer.storage_report(opt_parse["storage-sample"].as<size_t>());
+          const auto state_path =
+              storage_report_state_path(opt_parse, persistence_dir);
+          if (!state_path.empty()) {
+            ifstream previous_in(state_path);
+            if (previous_in) {
+              try {
+                report.compare_with(
+                    json::parse(previous_in).get<StorageReport>());
+              } catch (const exception &err) {
+                cerr << "warning: ignoring previous storage report in "
+                     << state_path << ": " << err.what() << endl;
+              }
+            }
+            ofstream(state_path) << json(report).dump() << endl;
+          }
+          if (!quiet) {
+            cout << json(report).dump(2) << endl;
+          }
+        }
+
+        if (opt_parse.count("cdc") > 0) {
+          CdcOptions cdc_options;
+          cdc_options.destination = opt_parse["cdc"].as<string>();
+          if (opt_parse.count("cdc-checkpoint") > 0) {
+            cdc_options.checkpoint_path =
+                opt_parse["cdc-checkpoint"].as<string>();
+          }
+          cdc_options.queue_capacity = opt_parse["cdc-queue"].as<size_t>();
+          CdcStream cdc(peer, cdc_options);
+          if (!quiet) {
+            lock_guard<mutex> lock(mtx);
+            status_out << "Streaming changes to " << cdc_options.destination
+                       << ". Press Ctrl+C to stop." << endl;
+          }
+          signal(SIGINT, taskscli_main_sigint_handler);
+          while (sigint_caught == 0 && cdc.running()) {
+            this_thread::sleep_for(chrono::milliseconds(200));
+          }
+          signal(SIGINT, SIG_DFL);
+
+          cdc.stop();
+          const auto stats = cdc.stats();
+          if (!quiet) {
+            status_out << "CDC: wrote " << stats.records_written
+                       << " records in " << stats.writes
+                       << " writes, up to sequence number " << stats.last_seq
+                       << "; waited for the target " << stats.backpressure_waits
+                       << " times" << endl;
+          }
+          if (!cdc.error().empty()) {
+            throw runtime_error("CDC stream stopped: " + cdc.error());
+          }
+
+          // Cancel final sync if user is streaming changes.
+          need_post_sync = false;
+        }
+
         if (opt_parse.count("monitor") > 0) {
           if (!quiet) {
             lock_guard<mutex> lock(mtx);
@@ -457,16 +1074,43 @@ int main(int argc, const char *argv[]) {
           need_post_sync = false;
         }
 
+        // Write buffered changes before the post-sync time, so that they
+        // are synced.
+        peer.flush_writes();
+
         if (need_post_sync && post_sync_sec > 0) {
           if (!quiet) {
-            cout << "Synchronizing tasks..." << endl;
+            status_out << "Synchronizing tasks..." << endl;
           }
           this_thread::sleep_for(chrono::seconds(post_sync_sec));
         }
 
         tasks_observer.reset();
+
+        if (retention_policy.enabled() && !quiet) {
+          const auto stats = peer.retention_stats();
+          status_out << "Retention: evicted " << stats.documents_evicted
+               << " tasks in " << stats.batches << " batches, "
+               << stats.time_spent.count() / 1000 << " ms total, "
+               << stats.max_batch_time.count() / 1000 << " ms longest"
+               << endl;
+        }
       } // !found_tui_command
 
+      peer.flush_writes();
+      if (write_behind.count() > 0 && !quiet) {
+        const auto stats = peer.write_behind_stats();
+        status_out << "Write-behind: " << stats.changes_buffered
+                   << " changes written as " << stats.tasks_written
+                   << " task updates in " << stats.flushes << " groups";
+        if (stats.tasks_discarded() > 0) {
+          status_out << "; discarded " << stats.tasks_missing
+                     << " updates to missing tasks and " << stats.tasks_failed
+                     << " failed updates";
+        }
+        status_out << endl;
+      }
+
       peer.stop_sync();
     } // peer destroyed
 
@@ -0,0 +1,187 @@
+#include "retention.h"
+#include "task.h"
+#include "tasks_log.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+using namespace std;
+using json = nlohmann::json;
+
+/// Extract the `_id` values from the result of a `SELECT _id` query.
+static vector<string> ids_from(const ditto::QueryResult &result) {
+  const auto item_count = result.item_count();
+  vector<string> ids;
+  ids.reserve(item_count);
+  for (size_t i = 0; i < item_count; ++i) {
+    ids.push_back(
+        json::parse(result.get_item(i).json_string()).at("_id").get<string>());
+  }
+  return ids;
+}
+
+RetentionEngine::RetentionEngine(shared_ptr<ditto::Ditto> ditto,
+                                 shared_ptr<mutex> store_mutex,
+                                 RetentionPolicy policy)
+    : ditto(std::move(ditto)), store_mutex(std::move(store_mutex)),
+      policy(std::move(policy)), worker([this] { run(); }) {}
+
+RetentionEngine::~RetentionEngine() noexcept {
+  {
+    lock_guard<mutex> lock(mtx);
+    stopping = true;
+  }
+  cv.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+RetentionStats RetentionEngine::stats() const {
+  lock_guard<mutex> lock(mtx);
+  return totals;
+}
+
+void RetentionEngine::run() {
+  unique_lock<mutex> lock(mtx);
+  while (!stopping) {
+    lock.unlock();
+    size_t evicted = 0;
+    try {
+      evicted = run_batch();
+    } catch (const exception &err) {
+      log_error("Retention batch failed: " + string(err.what()));
+    }
+    lock.lock();
+
+    // Keep going at the batch rate while there is work, and then back off.
+    const auto delay =
+        evicted > 0 ? policy.batch_interval : policy.idle_interval;
+    cv.wait_for(lock, delay, [this] { return stopping; });
+  }
+}
+
+size_t RetentionEngine::run_batch() {
+  if (policy.max_documents) {
+    refresh_document_count();
+  }
+
+  const auto start = chrono::steady_clock::now();
+
+  size_t evicted = 0;
+  {
+    lock_guard<mutex> store_lock(*store_mutex);
+    const auto ids = select_batch(max<size_t>(policy.batch_size, 1));
+    if (!ids.empty()) {
+      const auto stmt = "EVICT FROM tasks WHERE _id IN :ids";
+      const auto result = ditto->get_store().execute(stmt, {{"ids", ids}});
+      evicted = result.mutated_document_ids().size();
+    }
+  }
+
+  const auto elapsed = chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - start);
+  {
+    lock_guard<mutex> lock(mtx);
+    if (cached_document_count) {
+      *cached_document_count -= min(*cached_document_count, evicted);
+    }
+    totals.documents_evicted += evicted;
+    totals.batches += evicted > 0 ? 1 : 0;
+    totals.time_spent += elapsed;
+    totals.max_batch_time = max(totals.max_batch_time, elapsed);
+  }
+  if (evicted > 0) {
+    log_debug("Retention evicted " + to_string(evicted) + " tasks in " +
+              to_string(elapsed.count()) + " us");
+  }
+  return evicted;
+}
+
+void RetentionEngine::refresh_document_count() {
+  {
+    lock_guard<mutex> lock(mtx);
+    if (cached_document_count &&
+        chrono::steady_clock::now() - document_count_time <
+            policy.idle_interval) {
+      return;
+    }
+  }
+
+  // Counting reads the whole collection, so it is done without holding the
+  // store mutex, and only once per idle interval.  Between counts, the cached
+  // count is reduced by each eviction; documents added in the meantime are
+  // included by the next count.
+  const auto result = ditto->get_store().execute(
+      "SELECT COUNT(*) AS count FROM tasks");
+  const auto count =
+      result.item_count() > 0
+          ? json::parse(result.get_item(0).json_string())
+                .value("count", static_cast<size_t>(0))
+          : 0;
+
+  lock_guard<mutex> lock(mtx);
+  cached_document_count = count;
+  document_count_time = chrono::steady_clock::now();
+}
+
+size_t RetentionEngine::document_count() const {
+  lock_guard<mutex> lock(mtx);
+  return cached_document_count.value_or(0);
+}
+
+vector<string> RetentionEngine::select_batch(size_t limit) {
+  auto &store = ditto->get_store();
+  const auto limit_clause = " LIMIT " + to_string(limit);
+
+  if (policy.tombstone_max_age) {
+    const auto max_age_ms =
+        chrono::duration_cast<chrono::milliseconds>(*policy.tombstone_max_age)
+            .count();
+    const auto cutoff = task_timestamp_now() - max_age_ms;
+    // Tombstones written before tasks had timestamps, or by peers that do
+    // not set them, have no known age, and are treated as expired.
+    const auto query =
+        "SELECT _id FROM tasks"
+        " WHERE deleted = true"
+        " AND (modified_at < :cutoff OR modified_at IS MISSING)" +
+        limit_clause;
+    auto ids = ids_from(store.execute(query, {{"cutoff", cutoff}}));
+    if (!ids.empty()) {
+      return ids;
+    }
+  }
+
+  if (policy.max_completed_tasks) {
+    const auto query = "SELECT _id FROM tasks"
+                       " WHERE done = true AND NOT deleted"
+                       " ORDER BY modified_at DESC" +
+                       limit_clause + " OFFSET " +
+                       to_string(*policy.max_completed_tasks);
+    auto ids = ids_from(store.execute(query));
+    if (!ids.empty()) {
+      return ids;
+    }
+  }
+
+  if (policy.max_documents) {
+    const auto count = document_count();
+    if (count > *policy.max_documents) {
+      const auto batch_limit =
+          " LIMIT " + to_string(min(limit, count - *policy.max_documents));
+      // Each query is served by a single index, rather than sorting the
+      // whole collection: deleted tasks first, and then the oldest.
+      auto ids = ids_from(
+          store.execute("SELECT _id FROM tasks WHERE deleted = true" +
+                        batch_limit));
+      if (ids.empty()) {
+        ids = ids_from(store.execute(
+            "SELECT _id FROM tasks ORDER BY modified_at ASC" + batch_limit));
+      }
+      return ids;
+    }
+  }
+
+  return {};
+}
@@ -0,0 +1,130 @@
+#ifndef DITTO_QUICKSTART_RETENTION_H
+#define DITTO_QUICKSTART_RETENTION_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Ditto.h"
+
+/// Rules for evicting tasks from the local store.
+///
+/// Each rule is disabled if it is empty.  Tasks are ordered by their
+/// `modified_at` property, which TasksPeer sets on every change, so "oldest"
+/// means least recently modified.
+///
+/// Eviction only removes documents from the local store.  A document that is
+/// still matched by a sync subscription will be synced again from other peers,
+/// so rules that evict undeleted tasks are most useful together with a
+/// narrower subscription.
+struct RetentionPolicy {
+  /// Evict deleted tasks that were last modified longer ago than this.
+  /// Deleted tasks with no `modified_at` property, such as those written
+  /// before tasks had timestamps, are evicted regardless of age.
+  std::optional<std::chrono::seconds> tombstone_max_age;
+
+  /// Keep at most this many completed tasks that are not deleted, evicting
+  /// the oldest ones.
+  std::optional<std::size_t> max_completed_tasks;
+
+  /// Keep at most this many documents in the tasks collection, evicting
+  /// deleted tasks first, and then the oldest ones.
+  ///
+  /// The collection is counted at most once per `idle_interval`, so the
+  /// limit can be exceeded for that long by documents added in between.
+  std::optional<std::size_t> max_documents;
+
+  /// Maximum number of documents evicted by each batch.
+  std::size_t batch_size = 100;
+
+  /// Time to wait between batches while there is more to evict.
+  std::chrono::milliseconds batch_interval{200};
+
+  /// Time to wait before checking again after finding nothing to evict.
+  std::chrono::milliseconds idle_interval{30000};
+
+  /// Return true if any rule is enabled.
+  bool enabled() const {
+    return tombstone_max_age || max_completed_tasks || max_documents;
+  }
+};
+
+/// Cumulative statistics from a RetentionEngine.
+struct RetentionStats {
+  /// Number of documents evicted.
+  std::uint64_t documents_evicted = 0;
+
+  /// Number of batches that evicted at least one document.
+  std::uint64_t batches = 0;
+
+  /// Total time spent in batches, including those that found nothing to do.
+  std::chrono::microseconds time_spent{0};
+
+  /// Longest time spent in a single batch.
+  std::chrono::microseconds max_batch_time{0};
+};
+
+/// Applies a RetentionPolicy to the tasks collection on a background thread.
+///
+/// Work is done in small batches, each of which holds the store mutex only
+/// briefly, so that foreground operations are never delayed for long.
+class RetentionEngine {
+public:
+  /// Start the background thread.
+  ///
+  /// @param store_mutex mutex that is held while each batch runs, to
+  /// serialize batches with other operations on the store.
+  RetentionEngine(std::shared_ptr<ditto::Ditto> ditto,
+                  std::shared_ptr<std::mutex> store_mutex,
+                  RetentionPolicy policy);
+
+  /// Stop the background thread, waiting for a running batch to complete.
+  ~RetentionEngine() noexcept;
+
+  RetentionEngine(const RetentionEngine &) = delete;
+  RetentionEngine(RetentionEngine &&) = delete;
+
+  RetentionEngine &operator=(const RetentionEngine &) = delete;
+  RetentionEngine &operator=(RetentionEngine &&) = delete;
+
+  /// Return a copy of the statistics collected so far.
+  RetentionStats stats() const;
+
+private:
+  void run();
+
+  /// Evict up to one batch of documents, and return the number evicted.
+  std::size_t run_batch();
+
+  /// Return the IDs of up to `limit` documents to evict under the first rule
+  /// that has any.
+  std::vector<std::string> select_batch(std::size_t limit);
+
+  /// Count the documents in the collection, for the `max_documents` rule, if
+  /// the cached count is missing or older than the idle interval.
+  void refresh_document_count();
+
+  /// Return the cached document count.
+  std::size_t document_count() const;
+
+  std::shared_ptr<ditto::Ditto> ditto;
+  std::shared_ptr<std::mutex> store_mutex;
+  const RetentionPolicy policy;
+
+  mutable std::mutex mtx; // guards the members below
+  std::condition_variable cv;
+  RetentionStats totals;
+  std::optional<std::size_t> cached_document_count;
+  std::chrono::steady_clock::time_point document_count_time;
+  bool stopping = false;
+  std::thread worker; // must be declared last, as it uses the members above
+};
+
+#endif // DITTO_QUICKSTART_RETENTION_H
@@ -0,0 +1,92 @@
+#include "storage_report.h"
+
+#include <filesystem>
+#include <system_error>
+
+using namespace std;
+using json = nlohmann::json;
+
+void StorageReport::compare_with(const StorageReport &previous) {
+  StorageGrowth change;
+  change.since = previous.timestamp;
+  if (disk_bytes && previous.disk_bytes) {
+    change.disk_bytes = static_cast<int64_t>(*disk_bytes) -
+                        static_cast<int64_t>(*previous.disk_bytes);
+  }
+  change.live_documents = static_cast<int64_t>(live_documents) -
+                          static_cast<int64_t>(previous.live_documents);
+  change.tombstones = static_cast<int64_t>(tombstones) -
+                      static_cast<int64_t>(previous.tombstones);
+  growth = change;
+}
+
+void to_json(json &j, const StorageReport &report) {
+  j = json{{"timestamp", report.timestamp},
+           {"persistence_directory", report.persistence_directory},
+           {"disk_bytes", nullptr},
+           {"disk_files", report.disk_files},
+           {"live_documents", report.live_documents},
+           {"tombstones", report.tombstones},
+           {"sampled_documents", report.sampled_documents},
+           {"sample", report.sampled_all ? "all" : "prefix"},
+           {"average_document_bytes", report.average_document_bytes},
+           {"p99_document_bytes", report.p99_document_bytes},
+           {"max_document_bytes", report.max_document_bytes},
+           {"largest_titles", json::array()},
+           {"growth", nullptr}};
+  if (report.disk_bytes) {
+    j["disk_bytes"] = *report.disk_bytes;
+  }
+  for (const auto &title : report.largest_titles) {
+    j["largest_titles"].push_back(
+        {{"_id", title.task_id}, {"bytes", title.bytes}});
+  }
+  if (report.growth) {
+    const auto &growth = *report.growth;
+    j["growth"] = {{"since", growth.since},
+                   {"disk_bytes", nullptr},
+                   {"live_documents", growth.live_documents},
+                   {"tombstones", growth.tombstones}};
+    if (growth.disk_bytes) {
+      j["growth"]["disk_bytes"] = *growth.disk_bytes;
+    }
+  }
+}
+
+void from_json(const json &j, StorageReport &report) {
+  report.timestamp = j.value("timestamp", static_cast<int64_t>(0));
+  const auto disk_bytes = j.find("disk_bytes");
+  if (disk_bytes != j.end() && disk_bytes->is_number()) {
+    report.disk_bytes = disk_bytes->get<uint64_t>();
+  } else {
+    report.disk_bytes.reset();
+  }
+  report.live_documents = j.value("live_documents", static_cast<size_t>(0));
+  report.tombstones = j.value("tombstones", static_cast<size_t>(0));
+}
+
+optional<uint64_t> directory_size(const string &path, size_t &files) {
+  namespace fs = std::filesystem;
+  files = 0;
+  error_code ec;
+  if (path.empty() || !fs::is_directory(path, ec)) {
+    return nullopt;
+  }
+
+  uint64_t total = 0;
+  for (fs::recursive_directory_iterator
+           it(path, fs::directory_options::skip_permission_denied, ec),
+       end;
+       !ec && it != end; it.increment(ec)) {
+    error_code entry_ec;
+    if (!it->is_regular_file(entry_ec)) {
+      continue;
+    }
+    const auto size = it->file_size(entry_ec);
+    if (!entry_ec) {
+      total += size;
+      ++files;
+    }
+  }
+  return total;
+}
@@ -0,0 +1,97 @@
+#ifndef DITTO_QUICKSTART_STORAGE_REPORT_H
+#define DITTO_QUICKSTART_STORAGE_REPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Ditto.h"
+
+/// Size of a task's title, as listed in a StorageReport.
+struct TitleSize {
+  std::string task_id;
+  std::size_t bytes = 0;
+};
+
+/// Change in a peer's storage between two StorageReports.
+struct StorageGrowth {
+  /// Time of the earlier report, in milliseconds since the Unix epoch.
+  std::int64_t since = 0;
+
+  /// Change in the size of the persistence directory, if both reports have
+  /// it.
+  std::optional<std::int64_t> disk_bytes;
+
+  std::int64_t live_documents = 0;
+  std::int64_t tombstones = 0;
+};
+
+/// Summary of the storage used by a TasksPeer, returned by
+/// `TasksPeer::storage_report()`.
+///
+/// Document sizes are those of the documents' JSON representations, which
+/// approximates, but is not the same as, the space they use on disk.
+struct StorageReport {
+  /// Time of the report, in milliseconds since the Unix epoch.
+  std::int64_t timestamp = 0;
+
+  /// Path of the persistence directory, which is empty if the peer was
+  /// constructed without one (and so uses the SDK's default location).
+  std::string persistence_directory;
+
+  /// Total size of the files in the persistence directory, if it is known.
+  std::optional<std::uint64_t> disk_bytes;
+
+  /// Number of files in the persistence directory.
+  std::size_t disk_files = 0;
+
+  /// Number of tasks that are not deleted.
+  std::size_t live_documents = 0;
+
+  /// Number of deleted tasks that are still in the local store.
+  std::size_t tombstones = 0;
+
+  /// Number of documents whose sizes were measured.
+  std::size_t sampled_documents = 0;
+
+  /// False if the sizes were measured over a prefix of the collection: the
+  /// first `sampled_documents` documents in the store's order, rather than
+  /// all of them.  A prefix is not a random sample, and may, for example,
+  /// hold mostly old or mostly new tasks.
+  bool sampled_all = true;
+
+  double average_document_bytes = 0;
+  std::size_t p99_document_bytes = 0;
+  std::size_t max_document_bytes = 0;
+
+  /// The largest titles among the sampled documents, largest first.
+  std::vector<TitleSize> largest_titles;
+
+  /// Change since a previous report, set by `compare_with()`.
+  std::optional<StorageGrowth> growth;
+
+  /// Set `growth` to the change since `previous`.
+  void compare_with(const StorageReport &previous);
+};
+
+/// Copies data from a StorageReport to a JSON object.
+void to_json(nlohmann::json &j, const StorageReport &report);
+
+/// Copies data from a JSON object to a StorageReport.
+///
+/// Only the properties needed by `StorageReport::compare_with()` are read.
+void from_json(const nlohmann::json &j, StorageReport &report);
+
+/// Return the total size of the regular files under a directory, and set
+/// `files` to their number.
+///
+/// Files that cannot be examined, such as those removed while the directory
+/// is being read, are skipped.
+///
+/// @return an empty optional if the directory does not exist.
+std::optional<std::uint64_t> directory_size(const std::string &path,
+                                            std::size_t &files);
+
+#endif // DITTO_QUICKSTART_STORAGE_REPORT_H
@@ -1,16 +1,394 @@
 #include "task.h"
 
+#include <chrono>
+#include <cstring>
+
 void to_json(nlohmann::json &j, const Task &task) {
-  j = nlohmann::json{
-      {"title", task.title}, {"done", task.done}, {"deleted", task.deleted}};
+  j = nlohmann::json{{"title", task.title},
+                     {"done", task.done},
+                     {"deleted", task.deleted},
+                     {"created_at", task.created_at},
+                     {"modified_at", task.modified_at}};
   if (!task._id.empty()) {
     j["_id"] = task._id;
   }
 }
 
+/// Return a timestamp property of a JSON object, or 0 if it is missing or is
+/// not a number.
+static std::int64_t timestamp_from(const nlohmann::json &j, const char *key) {
+  const auto it = j.find(key);
+  return it != j.end() && it->is_number() ? it->get<std::int64_t>() : 0;
+}
+
 void from_json(const nlohmann::json &j, Task &task) {
   task._id = j.value("_id", "");
   task.title = j.value("title", "");
   task.done = j.value("done", false);
   task.deleted = j.value("deleted", false);
+  task.created_at = timestamp_from(j, "created_at");
+  task.modified_at = timestamp_from(j, "modified_at");
+  const auto body = j.find("body");
+  task.body_size = body != j.end() && body->is_object()
+                       ? body->value("len", static_cast<std::uint64_t>(0))
+                       : 0;
+}
+
+namespace {
+
+// Minimal scanner for the flat JSON objects that represent tasks.  Any input
+// that it does not handle (such as `\u` escapes or non-string IDs) makes it
+// give up, so that the caller can fall back to the general-purpose parser.
+class TaskJsonScanner {
+public:
+  explicit TaskJsonScanner(const std::string &json)
+      : p(json.data()), end(json.data() + json.size()) {}
+
+  bool scan(Task &task) {
+    bool seen_id = false;
+    bool seen_title = false;
+    bool seen_done = false;
+    bool seen_deleted = false;
+    bool seen_body = false;
+    bool seen_created_at = false;
+    bool seen_modified_at = false;
+
+    skip_whitespace();
+    if (!consume('{')) {
+      return false;
+    }
+    skip_whitespace();
+    if (!consume('}')) {
+      for (;;) {
+        const char *key = nullptr;
+        size_t key_size = 0;
+        skip_whitespace();
+        if (!scan_raw_string(key, key_size)) {
+          return false;
+        }
+        skip_whitespace();
+        if (!consume(':')) {
+          return false;
+        }
+        skip_whitespace();
+
+        bool ok = false;
+        if (key_equals(key, key_size, "_id")) {
+          ok = scan_string(task._id);
+          seen_id = true;
+        } else if (key_equals(key, key_size, "title")) {
+          ok = scan_string(task.title);
+          seen_title = true;
+        } else if (key_equals(key, key_size, "done")) {
+          ok = scan_bool(task.done);
+          seen_done = true;
+        } else if (key_equals(key, key_size, "deleted")) {
+          ok = scan_bool(task.deleted);
+          seen_deleted = true;
+        } else if (key_equals(key, key_size, "body")) {
+          ok = scan_attachment_size(task.body_size);
+          seen_body = true;
+        } else if (key_equals(key, key_size, "created_at")) {
+          ok = scan_timestamp(task.created_at);
+          seen_created_at = true;
+        } else if (key_equals(key, key_size, "modified_at")) {
+          ok = scan_timestamp(task.modified_at);
+          seen_modified_at = true;
+        } else {
+          ok = skip_value();
+        }
+        if (!ok) {
+          return false;
+        }
+
+        skip_whitespace();
+        if (consume('}')) {
+          break;
+        }
+        if (!consume(',')) {
+          return false;
+        }
+      }
+    }
+    skip_whitespace();
+    if (p != end) {
+      return false;
+    }
+
+    if (!seen_id) {
+      task._id.clear();
+    }
+    if (!seen_title) {
+      task.title.clear();
+    }
+    if (!seen_done) {
+      task.done = false;
+    }
+    if (!seen_deleted) {
+      task.deleted = false;
+    }
+    if (!seen_body) {
+      task.body_size = 0;
+    }
+    if (!seen_created_at) {
+      task.created_at = 0;
+    }
+    if (!seen_modified_at) {
+      task.modified_at = 0;
+    }
+    return true;
+  }
+
+private:
+  const char *p;
+  const char *end;
+
+  static bool key_equals(const char *key, size_t key_size, const char *name) {
+    return key_size == std::strlen(name) &&
+           std::memcmp(key, name, key_size) == 0;
+  }
+
+  void skip_whitespace() {
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+      ++p;
+    }
+  }
+
+  bool consume(char c) {
+    if (p != end && *p == c) {
+      ++p;
+      return true;
+    }
+    return false;
+  }
+
+  bool consume_literal(const char *literal) {
+    const auto size = std::strlen(literal);
+    if (static_cast<size_t>(end - p) >= size &&
+        std::memcmp(p, literal, size) == 0) {
+      p += size;
+      return true;
+    }
+    return false;
+  }
+
+  // Scan a string with no escape sequences, returning its raw contents.
+  bool scan_raw_string(const char *&start, size_t &size) {
+    if (!consume('"')) {
+      return false;
+    }
+    start = p;
+    while (p != end && *p != '"') {
+      if (*p == '\\') {
+        return false;
+      }
+      ++p;
+    }
+    if (p == end) {
+      return false;
+    }
+    size = static_cast<size_t>(p - start);
+    ++p;
+    return true;
+  }
+
+  // Scan a string value into the given string, reusing its capacity.
+  bool scan_string(std::string &out) {
+    if (!consume('"')) {
+      return false;
+    }
+    out.clear();
+    const char *run = p;
+    while (p != end && *p != '"') {
+      if (*p != '\\') {
+        ++p;
+        continue;
+      }
+      out.append(run, p);
+      if (++p == end) {
+        return false;
+      }
+      switch (*p) {
+      case '"':
+      case '\\':
+      case '/':
+        out.push_back(*p);
+        break;
+      case 'b':
+        out.push_back('\b');
+        break;
+      case 'f':
+        out.push_back('\f');
+        break;
+      case 'n':
+        out.push_back('\n');
+        break;
+      case 'r':
+        out.push_back('\r');
+        break;
+      case 't':
+        out.push_back('\t');
+        break;
+      default:
+        return false; // \u escapes are left to the general-purpose parser
+      }
+      run = ++p;
+    }
+    if (p == end) {
+      return false;
+    }
+    out.append(run, p);
+    ++p;
+    return true;
+  }
+
+  bool scan_bool(bool &out) {
+    if (consume_literal("true")) {
+      out = true;
+      return true;
+    } else if (consume_literal("false") || consume_literal("null")) {
+      out = false;
+      return true;
+    }
+    return false;
+  }
+
+  // Scan an unsigned integer.
+  bool scan_uint(std::uint64_t &out) {
+    if (p == end || *p < '0' || *p > '9') {
+      return false;
+    }
+    out = 0;
+    while (p != end && *p >= '0' && *p <= '9') {
+      out = out * 10 + static_cast<std::uint64_t>(*p - '0');
+      ++p;
+    }
+    return true;
+  }
+
+  // Scan a timestamp, which must be a non-negative integer (or null).
+  bool scan_timestamp(std::int64_t &out) {
+    std::uint64_t value = 0;
+    if (consume_literal("null")) {
+      out = 0;
+      return true;
+    }
+    // Anything else, such as a fraction or exponent, is left to the
+    // general-purpose parser.
+    if (!scan_uint(value) ||
+        (p != end && (*p == '.' || *p == 'e' || *p == 'E'))) {
+      return false;
+    }
+    out = static_cast<std::int64_t>(value);
+    return true;
+  }
+
+  // Scan an attachment token (or null), extracting its `len` property.
+  bool scan_attachment_size(std::uint64_t &out) {
+    out = 0;
+    if (consume_literal("null")) {
+      return true;
+    }
+    if (!consume('{')) {
+      return false;
+    }
+    skip_whitespace();
+    if (consume('}')) {
+      return true;
+    }
+    for (;;) {
+      const char *key = nullptr;
+      size_t key_size = 0;
+      skip_whitespace();
+      if (!scan_raw_string(key, key_size)) {
+        return false;
+      }
+      skip_whitespace();
+      if (!consume(':')) {
+        return false;
+      }
+      skip_whitespace();
+      const bool ok = key_equals(key, key_size, "len") ? scan_uint(out)
+                                                       : skip_value();
+      if (!ok) {
+        return false;
+      }
+      skip_whitespace();
+      if (consume('}')) {
+        return true;
+      }
+      if (!consume(',')) {
+        return false;
+      }
+    }
+  }
+
+  // Skip over any JSON value.
+  bool skip_value() {
+    size_t depth = 0;
+    do {
+      skip_whitespace();
+      if (p == end) {
+        return false;
+      }
+      switch (*p) {
+      case '{':
+      case '[':
+        ++depth;
+        ++p;
+        continue;
+      case '}':
+      case ']':
+        if (depth == 0) {
+          return false;
+        }
+        --depth;
+        ++p;
+        break;
+      case ',':
+      case ':':
+        if (depth == 0) {
+          return false;
+        }
+        ++p;
+        continue;
+      case '"':
+        ++p;
+        while (p != end && *p != '"') {
+          if (*p == '\\' && ++p == end) {
+            return false;
+          }
+          ++p;
+        }
+        if (p == end) {
+          return false;
+        }
+        ++p;
+        break;
+      default:
+        // number or literal
+        while (p != end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' &&
+               *p != '\t' && *p != '\n' && *p != '\r') {
+          ++p;
+        }
+        break;
+      }
+    } while (depth > 0);
+    return true;
+  }
+};
+
+} // end anonymous namespace
+
+void from_json_string(const std::string &json, Task &task) {
+  TaskJsonScanner scanner(json);
+  if (!scanner.scan(task)) {
+    from_json(nlohmann::json::parse(json), task);
+  }
+}
+
+std::int64_t task_timestamp_now() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch())
+      .count();
 }
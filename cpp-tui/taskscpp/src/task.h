@@ -1,6 +1,7 @@
 #ifndef DITTO_QUICKSTART_TASK_H
 #define DITTO_QUICKSTART_TASK_H
 
+#include <cstdint>
 #include <string>
 
 #include "Ditto.h"
@@ -15,6 +16,21 @@ struct Task {
   bool done = false;
   bool deleted = false;
 
+  /// Size in bytes of the task's body, or 0 if it has none.
+  ///
+  /// The body itself is stored as a Ditto attachment, which is referenced by
+  /// the task's `body` property, and is only fetched on request (see
+  /// `TasksPeer::fetch_task_body()`).  It is not written by `to_json()`.
+  std::uint64_t body_size = 0;
+
+  /// Time at which the task was created, in the form returned by
+  /// `task_timestamp_now()`, or 0 if it is not known.
+  std::int64_t created_at = 0;
+
+  /// Time at which the task was last changed, in the form returned by
+  /// `task_timestamp_now()`.  TasksPeer sets this on every change.
+  std::int64_t modified_at = 0;
+
   Task() = default;
 
   Task(const std::string &id, const std::string &ttl, bool is_done = false,
@@ -25,7 +41,10 @@ struct Task {
     return _id == other._id &&     //
            title == other.title && //
            done == other.done &&   //
-           deleted == other.deleted;
+           deleted == other.deleted && //
+           body_size == other.body_size && //
+           created_at == other.created_at && //
+           modified_at == other.modified_at;
   }
 };
 
@@ -39,4 +58,17 @@ void to_json(nlohmann::json &j, const Task &task);
 /// Copies data from a JSON object to a Task.
 void from_json(const nlohmann::json &j, Task &task);
 
+/// Copies data from a JSON object's text representation to a Task.
+///
+/// The result is the same as `from_json(nlohmann::json::parse(json), task)`,
+/// but for typical documents no intermediate JSON object is built and the
+/// existing capacity of the Task's strings is reused, so that decoding into a
+/// recycled Task does not allocate memory.
+void from_json_string(const std::string &json, Task &task);
+
+/// Return the current time in the form used for the `modified_at` property
+/// that TasksPeer sets whenever it changes a task: milliseconds since the Unix
+/// epoch.
+std::int64_t task_timestamp_now();
+
 #endif // DITTO_QUICKSTART_TASK_H
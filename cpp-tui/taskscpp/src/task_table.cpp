@@ -0,0 +1,322 @@
+#include "task_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// Offsets of the first hex digit of each byte in a canonical textual UUID.
+constexpr size_t UUID_BYTE_POSITIONS[16] = {0,  2,  4,  6,  9,  11, 14, 16,
+                                            19, 21, 24, 26, 28, 30, 32, 34};
+
+// Offsets of the dashes in a canonical textual UUID.
+constexpr size_t UUID_DASH_POSITIONS[4] = {8, 13, 18, 23};
+
+// Table mapping characters to hex digit values, with bit 4 set for lowercase
+// letters and bit 5 set for uppercase letters.  Non-hex characters map to 0xFF.
+struct HexTable {
+  uint8_t values[256];
+
+  constexpr HexTable() : values() {
+    for (auto &value : values) {
+      value = 0xFF;
+    }
+    for (int c = '0'; c <= '9'; ++c) {
+      values[c] = static_cast<uint8_t>(c - '0');
+    }
+    for (int c = 'a'; c <= 'f'; ++c) {
+      values[c] = static_cast<uint8_t>(0x10 | (c - 'a' + 10));
+    }
+    for (int c = 'A'; c <= 'F'; ++c) {
+      values[c] = static_cast<uint8_t>(0x20 | (c - 'A' + 10));
+    }
+  }
+};
+
+constexpr HexTable HEX_TABLE;
+
+int compare_views(string_view a, string_view b) {
+  const auto result = a.compare(b);
+  return result < 0 ? -1 : (result > 0 ? 1 : 0);
+}
+
+// FNV-1a
+size_t hash_bytes(const void *data, size_t size) {
+  uint64_t hash = 14695981039346656037ULL;
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return static_cast<size_t>(hash);
+}
+
+} // end anonymous namespace
+
+void TaskTable::BitVector::push_back(bool value) {
+  if (bit_count % 64 == 0) {
+    words.push_back(0);
+  }
+  if (value) {
+    words.back() |= uint64_t{1} << (bit_count % 64);
+  }
+  ++bit_count;
+}
+
+bool TaskTable::parse_uuid(string_view id, ParsedUuid &parsed) noexcept {
+  if (id.size() != UUID_STRING_SIZE) {
+    return false;
+  }
+  for (const auto pos : UUID_DASH_POSITIONS) {
+    if (id[pos] != '-') {
+      return false;
+    }
+  }
+
+  uint8_t seen = 0; // union of all table entries, to detect errors and case
+  for (size_t i = 0; i < parsed.bytes.size(); ++i) {
+    const auto pos = UUID_BYTE_POSITIONS[i];
+    const auto high = HEX_TABLE.values[static_cast<uint8_t>(id[pos])];
+    const auto low = HEX_TABLE.values[static_cast<uint8_t>(id[pos + 1])];
+    seen |= high | low;
+    parsed.bytes[i] = static_cast<uint8_t>(((high & 0xF) << 4) | (low & 0xF));
+  }
+
+  // Reject non-hex characters, and mixed-case IDs, which can't be reproduced
+  // exactly from the binary form.
+  if ((seen & 0xC0) != 0 || (seen & 0x30) == 0x30) {
+    return false;
+  }
+  parsed.upper = (seen & 0x20) != 0;
+  return true;
+}
+
+void TaskTable::format_uuid(const IdSlot &bytes, bool upper,
+                            UuidChars &chars) noexcept {
+  const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  for (const auto pos : UUID_DASH_POSITIONS) {
+    chars[pos] = '-';
+  }
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    const auto pos = UUID_BYTE_POSITIONS[i];
+    chars[pos] = digits[bytes[i] >> 4];
+    chars[pos + 1] = digits[bytes[i] & 0xF];
+  }
+}
+
+TaskTable::TaskTable(const vector<Task> &tasks) {
+  size_t title_bytes = 0;
+  for (const auto &task : tasks) {
+    title_bytes += task.title.size();
+  }
+  reserve(tasks.size(), title_bytes);
+  for (const auto &task : tasks) {
+    push_back(task);
+  }
+}
+
+void TaskTable::reserve(size_t row_count, size_t title_bytes) {
+  ids.reserve(row_count);
+  text_id_bits.reserve(row_count);
+  upper_bits.reserve(row_count);
+  done_bits.reserve(row_count);
+  deleted_bits.reserve(row_count);
+  body_sizes.reserve(row_count);
+  created_ats.reserve(row_count);
+  modified_ats.reserve(row_count);
+  title_offsets.reserve(row_count + 1);
+  titles.reserve(title_bytes);
+}
+
+void TaskTable::push_back(const Task &task) {
+  if (titles.size() + task.title.size() > numeric_limits<uint32_t>::max() ||
+      text_ids.size() + task._id.size() > numeric_limits<uint32_t>::max()) {
+    throw length_error("TaskTable capacity exceeded");
+  }
+
+  IdSlot slot{};
+  ParsedUuid parsed{};
+  const auto is_uuid = parse_uuid(task._id, parsed);
+  if (is_uuid) {
+    slot = parsed.bytes;
+  } else {
+    const auto offset = static_cast<uint32_t>(text_ids.size());
+    const auto length = static_cast<uint32_t>(task._id.size());
+    memcpy(slot.data(), &offset, sizeof(offset));
+    memcpy(slot.data() + sizeof(offset), &length, sizeof(length));
+    text_ids.append(task._id);
+  }
+
+  ids.push_back(slot);
+  text_id_bits.push_back(!is_uuid);
+  upper_bits.push_back(is_uuid && parsed.upper);
+  done_bits.push_back(task.done);
+  deleted_bits.push_back(task.deleted);
+  body_sizes.push_back(task.body_size);
+  created_ats.push_back(task.created_at);
+  modified_ats.push_back(task.modified_at);
+  titles.append(task.title);
+  title_offsets.push_back(static_cast<uint32_t>(titles.size()));
+
+  const auto count = size();
+  if (sorted_by_id && count > 1 && compare_ids(count - 2, count - 1) > 0) {
+    sorted_by_id = false;
+  }
+}
+
+void TaskTable::clear() noexcept {
+  ids.clear();
+  text_id_bits.clear();
+  upper_bits.clear();
+  done_bits.clear();
+  deleted_bits.clear();
+  body_sizes.clear();
+  created_ats.clear();
+  modified_ats.clear();
+  title_offsets.resize(1);
+  titles.clear();
+  text_ids.clear();
+  sorted_by_id = true;
+}
+
+string_view TaskTable::text_id_view(size_t i) const noexcept {
+  uint32_t offset = 0;
+  uint32_t length = 0;
+  memcpy(&offset, ids[i].data(), sizeof(offset));
+  memcpy(&length, ids[i].data() + sizeof(offset), sizeof(length));
+  return string_view(text_ids).substr(offset, length);
+}
+
+string TaskTable::id_string(size_t i) const {
+  if (has_text_id(i)) {
+    return string(text_id_view(i));
+  }
+  UuidChars chars;
+  format_uuid(ids[i], upper_bits.test(i), chars);
+  return string(chars.data(), chars.size());
+}
+
+int TaskTable::compare_id_to(size_t i, string_view id,
+                             const ParsedUuid *parsed) const noexcept {
+  if (has_text_id(i)) {
+    return compare_views(text_id_view(i), id);
+  }
+
+  const auto upper = upper_bits.test(i);
+  if (parsed != nullptr && parsed->upper == upper) {
+    // Same-case hex digits sort the same way as the bytes they encode.
+    const auto result =
+        memcmp(ids[i].data(), parsed->bytes.data(), ids[i].size());
+    return result < 0 ? -1 : (result > 0 ? 1 : 0);
+  }
+
+  if (parsed != nullptr) {
+    // Compare digit by digit, as the textual forms use different cases.
+    const auto digit = [](uint8_t nibble, bool is_upper) {
+      return nibble < 10 ? '0' + nibble : (is_upper ? 'A' : 'a') + nibble - 10;
+    };
+    for (size_t b = 0; b < ids[i].size(); ++b) {
+      for (const auto shift : {4, 0}) {
+        const auto lhs = digit((ids[i][b] >> shift) & 0xF, upper);
+        const auto rhs = digit((parsed->bytes[b] >> shift) & 0xF, parsed->upper);
+        if (lhs != rhs) {
+          return lhs < rhs ? -1 : 1;
+        }
+      }
+    }
+    return 0;
+  }
+
+  UuidChars chars;
+  format_uuid(ids[i], upper, chars);
+  return compare_views(string_view(chars.data(), chars.size()), id);
+}
+
+int TaskTable::compare_ids(size_t a, size_t b) const noexcept {
+  if (has_text_id(b)) {
+    return compare_id_to(a, text_id_view(b), nullptr);
+  }
+
+  const ParsedUuid parsed{ids[b], upper_bits.test(b)};
+  UuidChars chars;
+  format_uuid(parsed.bytes, parsed.upper, chars);
+  return compare_id_to(a, string_view(chars.data(), chars.size()), &parsed);
+}
+
+size_t TaskTable::find(string_view id) const noexcept {
+  ParsedUuid parsed{};
+  const auto *parsed_ptr = parse_uuid(id, parsed) ? &parsed : nullptr;
+
+  if (sorted_by_id) {
+    size_t low = 0;
+    size_t high = size();
+    while (low < high) {
+      const auto mid = low + (high - low) / 2;
+      const auto result = compare_id_to(mid, id, parsed_ptr);
+      if (result == 0) {
+        return mid;
+      } else if (result < 0) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return npos;
+  }
+
+  for (size_t i = 0; i < size(); ++i) {
+    if (parsed_ptr != nullptr) {
+      if (!has_text_id(i) && upper_bits.test(i) == parsed.upper &&
+          ids[i] == parsed.bytes) {
+        return i;
+      }
+    } else if (has_text_id(i) && text_id_view(i) == id) {
+      return i;
+    }
+  }
+  return npos;
+}
+
+size_t TaskTable::hash_id(size_t i) const noexcept {
+  if (has_text_id(i)) {
+    const auto id = text_id_view(i);
+    return hash_bytes(id.data(), id.size());
+  }
+  return hash_bytes(ids[i].data(), ids[i].size()) ^
+         static_cast<size_t>(upper_bits.test(i));
+}
+
+vector<Task> TaskTable::to_tasks() const {
+  vector<Task> tasks;
+  tasks.reserve(size());
+  for (const auto row : *this) {
+    tasks.push_back(row.to_task());
+  }
+  return tasks;
+}
+
+size_t TaskTable::memory_usage() const noexcept {
+  return ids.capacity() * sizeof(IdSlot) + text_id_bits.memory_usage() +
+         upper_bits.memory_usage() + done_bits.memory_usage() +
+         deleted_bits.memory_usage() +
+         body_sizes.capacity() * sizeof(uint64_t) +
+         created_ats.capacity() * sizeof(int64_t) +
+         modified_ats.capacity() * sizeof(int64_t) +
+         title_offsets.capacity() * sizeof(uint32_t) + titles.capacity() +
+         text_ids.capacity();
+}
+
+bool TaskTable::operator==(const TaskTable &other) const noexcept {
+  // Rows are encoded deterministically, so equal rows have equal columns.
+  return ids == other.ids && text_id_bits == other.text_id_bits &&
+         upper_bits == other.upper_bits && done_bits == other.done_bits &&
+         deleted_bits == other.deleted_bits &&
+         body_sizes == other.body_sizes && created_ats == other.created_ats &&
+         modified_ats == other.modified_ats &&
+         title_offsets == other.title_offsets && titles == other.titles &&
+         text_ids == other.text_ids;
+}
@@ -0,0 +1,242 @@
+#ifndef DITTO_QUICKSTART_TASK_TABLE_H
+#define DITTO_QUICKSTART_TASK_TABLE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "task.h"
+
+/// Compact column-oriented representation of a collection of tasks.
+///
+/// This is intended for large result sets, where a `std::vector<Task>` costs
+/// two heap strings per task.  IDs that are canonical UUID strings (such as
+/// those generated by the QuickStart apps) are stored as 16 binary bytes, the
+/// `done` and `deleted` flags are bit-packed, and all titles share a single
+/// contiguous buffer.  IDs that are not UUIDs are stored as text, so any
+/// collection of tasks can be represented.  Body sizes and timestamps are
+/// stored in plain columns.
+///
+/// Rows are accessed through `TaskTable::Row`, which has accessors mirroring
+/// the data members of `Task`, so every Task survives a round trip through a
+/// table unchanged.
+///
+/// The application does not use this; it is measured against
+/// `std::vector<Task>` by bench/task_table_bench.cpp, to show what a compact
+/// layout would save before adopting it for the TUI's task list.
+class TaskTable {
+public:
+  /// Read-only view of one row of a TaskTable.
+  ///
+  /// A Row is only valid while the table it refers to is alive and unmodified.
+  class Row {
+  public:
+    Row(const TaskTable &table, std::size_t index) noexcept
+        : table(&table), index(index) {}
+
+    /// The task's ID, in the same textual form it was added with.
+    std::string id() const { return table->id_string(index); }
+
+    std::string_view title() const { return table->title_view(index); }
+
+    bool done() const noexcept { return table->done_bits.test(index); }
+
+    bool deleted() const noexcept { return table->deleted_bits.test(index); }
+
+    std::uint64_t body_size() const noexcept {
+      return table->body_sizes[index];
+    }
+
+    std::int64_t created_at() const noexcept {
+      return table->created_ats[index];
+    }
+
+    std::int64_t modified_at() const noexcept {
+      return table->modified_ats[index];
+    }
+
+    /// Return a copy of this row as a Task, equal to the one it was added
+    /// from.
+    Task to_task() const {
+      Task task(id(), std::string(title()), done(), deleted());
+      task.body_size = body_size();
+      task.created_at = created_at();
+      task.modified_at = modified_at();
+      return task;
+    }
+
+    /// Position of this row in its table.
+    std::size_t position() const noexcept { return index; }
+
+  private:
+    const TaskTable *table;
+    std::size_t index;
+  };
+
+  /// Iterator over the rows of a TaskTable.
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Row;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Row;
+
+    const_iterator(const TaskTable &table, std::size_t index) noexcept
+        : table(&table), index(index) {}
+
+    Row operator*() const noexcept { return {*table, index}; }
+
+    const_iterator &operator++() noexcept {
+      ++index;
+      return *this;
+    }
+
+    const_iterator operator++(int) noexcept {
+      auto it = *this;
+      ++index;
+      return it;
+    }
+
+    bool operator==(const const_iterator &other) const noexcept {
+      return table == other.table && index == other.index;
+    }
+
+    bool operator!=(const const_iterator &other) const noexcept {
+      return !(*this == other);
+    }
+
+  private:
+    const TaskTable *table;
+    std::size_t index;
+  };
+
+  /// Value returned by find() if there is no matching row.
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+  TaskTable() = default;
+
+  /// Construct a table containing copies of the given tasks, in order.
+  explicit TaskTable(const std::vector<Task> &tasks);
+
+  /// Reserve space for the given number of rows and total bytes of titles.
+  void reserve(std::size_t row_count, std::size_t title_bytes = 0);
+
+  /// Append a copy of a task.
+  void push_back(const Task &task);
+
+  /// Remove all rows, retaining allocated capacity.
+  void clear() noexcept;
+
+  std::size_t size() const noexcept { return title_offsets.size() - 1; }
+
+  bool empty() const noexcept { return size() == 0; }
+
+  Row operator[](std::size_t i) const noexcept { return {*this, i}; }
+
+  const_iterator begin() const noexcept { return {*this, 0}; }
+  const_iterator end() const noexcept { return {*this, size()}; }
+
+  /// Return true if rows have been added in nondecreasing ID order (as
+  /// produced by queries with `ORDER BY _id`).
+  bool is_sorted_by_id() const noexcept { return sorted_by_id; }
+
+  /// Return the position of the row with the given ID, or `npos` if there is
+  /// none.
+  ///
+  /// This is a binary search if the table is sorted by ID, and a linear scan of
+  /// the binary IDs otherwise.  No heap allocation is performed.
+  std::size_t find(std::string_view id) const noexcept;
+
+  /// Compare the IDs of two rows using the same ordering as the textual IDs.
+  int compare_ids(std::size_t a, std::size_t b) const noexcept;
+
+  /// Hash of a row's ID, computed from its compact form.
+  std::size_t hash_id(std::size_t i) const noexcept;
+
+  /// Return copies of all rows as Task objects.
+  std::vector<Task> to_tasks() const;
+
+  /// Number of bytes of heap memory allocated by this table, including unused
+  /// capacity.
+  std::size_t memory_usage() const noexcept;
+
+  /// Two tables are equal if they contain equal rows in the same order.
+  bool operator==(const TaskTable &other) const noexcept;
+  bool operator!=(const TaskTable &other) const noexcept {
+    return !(*this == other);
+  }
+
+private:
+  // Growable array of bits.
+  class BitVector {
+  public:
+    bool test(std::size_t i) const noexcept {
+      return (words[i / 64] >> (i % 64)) & 1U;
+    }
+    void push_back(bool value);
+    void reserve(std::size_t count) { words.reserve((count + 63) / 64); }
+    void clear() noexcept {
+      words.clear();
+      bit_count = 0;
+    }
+    std::size_t memory_usage() const noexcept {
+      return words.capacity() * sizeof(std::uint64_t);
+    }
+    bool operator==(const BitVector &other) const noexcept {
+      return bit_count == other.bit_count && words == other.words;
+    }
+
+  private:
+    std::vector<std::uint64_t> words;
+    std::size_t bit_count = 0;
+  };
+
+  // Binary UUID, or for a text ID, its offset and length in text_ids.
+  using IdSlot = std::array<std::uint8_t, 16>;
+
+  // Textual UUID length, e.g. "50191411-4C46-4940-8B72-5F8017A04FA7"
+  static constexpr std::size_t UUID_STRING_SIZE = 36;
+  using UuidChars = std::array<char, UUID_STRING_SIZE>;
+
+  // Result of parsing a textual ID as a UUID.
+  struct ParsedUuid {
+    IdSlot bytes;
+    bool upper;
+  };
+
+  static bool parse_uuid(std::string_view id, ParsedUuid &parsed) noexcept;
+  static void format_uuid(const IdSlot &bytes, bool upper,
+                          UuidChars &chars) noexcept;
+
+  bool has_text_id(std::size_t i) const noexcept {
+    return text_id_bits.test(i);
+  }
+  std::string id_string(std::size_t i) const;
+  std::string_view text_id_view(std::size_t i) const noexcept;
+  std::string_view title_view(std::size_t i) const noexcept {
+    return std::string_view(titles).substr(
+        title_offsets[i], title_offsets[i + 1] - title_offsets[i]);
+  }
+  int compare_id_to(std::size_t i, std::string_view id,
+                    const ParsedUuid *parsed) const noexcept;
+
+  std::vector<IdSlot> ids;
+  BitVector text_id_bits;   // set if ids[i] refers to text_ids
+  BitVector upper_bits;     // set if a UUID was written with uppercase hex
+  BitVector done_bits;
+  BitVector deleted_bits;
+  std::vector<std::uint64_t> body_sizes;
+  std::vector<std::int64_t> created_ats;
+  std::vector<std::int64_t> modified_ats;
+  std::vector<std::uint32_t> title_offsets{0}; // size() + 1 entries
+  std::string titles;
+  std::string text_ids;
+  bool sorted_by_id = true;
+};
+
+#endif // DITTO_QUICKSTART_TASK_TABLE_H
@@ -14,6 +14,11 @@ void log_debug(const std::string &msg) { ditto::Log::d(msg); }
 
 void log_verbose(const std::string &msg) { ditto::Log::v(msg); }
 
+bool is_log_debug_enabled() {
+  return ditto::Log::get_logging_enabled() &&
+         ditto::Log::get_minimum_log_level() >= ditto::LogLevel::debug;
+}
+
 bool get_logging_enabled() { return ditto::Log::get_logging_enabled(); }
 
 void set_logging_enabled(bool enabled) {
@@ -11,6 +11,9 @@ void log_info(const std::string &msg);
 void log_debug(const std::string &msg);
 void log_verbose(const std::string &msg);
 
+/// Return true if messages passed to log_debug() will be logged.
+bool is_log_debug_enabled();
+
 bool get_logging_enabled();
 void set_logging_enabled(bool enabled);
 
@@ -1,11 +1,17 @@
 #include "tasks_peer.h"
+#include "retention.h"
+#include "storage_report.h"
 #include "tasks_log.h"
-#include "transform_container.h"
+#include "write_buffer.h"
 
 #include "Ditto.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
 #include <iostream>
 #include <mutex>
+#include <regex>
 #include <sstream>
 #include <stdexcept>
 #include <thread>
@@ -15,56 +21,169 @@ using json = nlohmann::json;
 
 /// Extract a Task object from a QueryResultItem.
 static Task task_from(const ditto::QueryResultItem &item) {
-  return json::parse(item.json_string()).template get<Task>();
+  Task task;
+  from_json_string(item.json_string(), task);
+  return task;
 }
 
-/// Convert a QueryResult to a collection of Task objects.
-static vector<Task> tasks_from(const ditto::QueryResult &result) {
+/// Convert a QueryResult to a collection of Task objects, reusing the elements
+/// of the given vector.
+///
+/// When the vector is recycled across calls, the vector's buffer and the
+/// existing Task strings are reused, so once the vector has grown to the size
+/// of the result set, decoding performs no memory allocation.
+static void tasks_from(const ditto::QueryResult &result, vector<Task> &tasks) {
   const auto item_count = result.item_count();
-  vector<Task> tasks;
-  tasks.reserve(item_count);
+  tasks.resize(item_count);
   for (size_t i = 0; i < item_count; ++i) {
-    tasks.emplace_back(task_from(result.get_item(i)));
+    from_json_string(result.get_item(i).json_string(), tasks[i]);
   }
+}
+
+/// Convert a QueryResult to a collection of Task objects.
+static vector<Task> tasks_from(const ditto::QueryResult &result) {
+  vector<Task> tasks;
+  tasks_from(result, tasks);
   return tasks;
 }
 
+/// Apply the changes pending in a WriteBuffer to a collection of tasks,
+/// removing tasks that the changes delete unless `include_deleted_tasks` is
+/// set.  Does nothing if `buffer` is null.
+static void overlay_pending(const WriteBuffer *buffer, vector<Task> &tasks,
+                            bool include_deleted_tasks) {
+  if (buffer == nullptr) {
+    return;
+  }
+  for (auto &task : tasks) {
+    buffer->overlay(task);
+  }
+  if (!include_deleted_tasks) {
+    tasks.erase(remove_if(tasks.begin(), tasks.end(),
+                          [](const Task &task) { return task.deleted; }),
+                tasks.end());
+  }
+}
+
 /// Convert a QueryResult to a JSON string
+///
+/// The string is built directly, rather than by collecting copies of the items
+/// into an intermediate JSON array and then serializing that.
 static string to_json_string(const ditto::QueryResult &result) {
-  const auto items = transform_container<vector<string>>(
-      result.items(),
-      [](const ditto::QueryResultItem &item) { return item.json_string(); });
+  string out = "{\"items\":[";
+  const auto item_count = result.item_count();
+  for (size_t i = 0; i < item_count; ++i) {
+    if (i > 0) {
+      out += ',';
+    }
+    out += json(result.get_item(i).json_string()).dump();
+  }
+  out += "],\"modified_document_ids\":[";
+  bool first = true;
+  for (const auto &id : result.mutated_document_ids()) {
+    if (!first) {
+      out += ',';
+    }
+    first = false;
+    out += json(id.to_string()).dump();
+  }
+  out += "]}";
+  return out;
+}
+
+/// Number of times the cutoff of the recent subscription set by
+/// `TasksPeer::set_subscriptions()` is moved forward per window (and at least
+/// once an hour).
+static constexpr int RECENT_REFRESHES_PER_WINDOW = 24;
 
-  const auto modified_document_ids = transform_container<vector<string>>(
-      result.mutated_document_ids(),
-      [](const ditto::DocumentId &id) { return id.to_string(); });
+/// Number of times `TasksPeer::toggle_task()` tries both statuses before
+/// concluding that the task does not exist.
+static constexpr int TOGGLE_ATTEMPTS = 2;
 
-  nlohmann::json result_json = {
-      {"items", items}, {"modified_document_ids", modified_document_ids}};
-  return result_json.dump();
+/// Number of titles listed in a StorageReport.
+static constexpr size_t LARGEST_TITLE_COUNT = 10;
+
+/// Query for the properties needed to count tasks.
+static const char *const count_tasks_query =
+    "SELECT _id, done, deleted FROM tasks";
+
+/// Count the tasks in the result of `count_tasks_query`.
+static TaskStats tally_tasks(const ditto::QueryResult &result, Task &scratch) {
+  TaskStats stats;
+  const auto item_count = result.item_count();
+  for (size_t i = 0; i < item_count; ++i) {
+    from_json_string(result.get_item(i).json_string(), scratch);
+    if (scratch.deleted) {
+      ++stats.deleted;
+    } else if (scratch.done) {
+      ++stats.done;
+    } else {
+      ++stats.open;
+    }
+  }
+  return stats;
 }
 
+/// Task counts shared between a TasksPeer and the observer that updates them.
+struct TaskCounter {
+  mutex mtx; // guards stats
+  TaskStats stats;
+};
+
+/// Return the value of the `count` property of the first item of a
+/// `SELECT COUNT(*) AS count` result.
+static size_t count_from(const ditto::QueryResult &result) {
+  if (result.item_count() == 0) {
+    return 0;
+  }
+  return json::parse(result.get_item(0).json_string())
+      .value("count", static_cast<size_t>(0));
+}
+
+/// Statements that create the indexes used by the queries in this file.
+///
+/// These use `IF NOT EXISTS`, so they can be run every time the peer starts.
+static const vector<string> index_statements = {
+    // Every listing and observer query filters on `deleted`, as does eviction.
+    "CREATE INDEX IF NOT EXISTS tasks_deleted_idx ON tasks (deleted)",
+    // Retention of completed tasks filters on `done`.
+    "CREATE INDEX IF NOT EXISTS tasks_done_idx ON tasks (done)",
+    // Retention and `get_tasks_modified_since()` order by `modified_at`.
+    "CREATE INDEX IF NOT EXISTS tasks_modified_at_idx ON tasks (modified_at)",
+};
+
 /// Initialize a Ditto instance.
 static shared_ptr<ditto::Ditto> init_ditto(string app_id,
                                            string online_playground_token,
                                            string websocket_url,
                                            string auth_url,
                                            bool enable_cloud_sync,
-                                           string persistence_dir) {
+                                           string persistence_dir,
+                                           const TransportOptions &transport) {
   try {
-    const auto identity = ditto::Identity::OnlinePlayground(
-        std::move(app_id), 
-        std::move(online_playground_token),
-        enable_cloud_sync,
-        std::move(auth_url));
+    if (transport.offline_identity && enable_cloud_sync) {
+      throw invalid_argument("an offline identity cannot use cloud sync");
+    }
+    const auto identity =
+        transport.offline_identity
+            ? ditto::Identity::OfflinePlayground(std::move(app_id))
+            : ditto::Identity::OnlinePlayground(
+                  std::move(app_id), 
+                  std::move(online_playground_token),
+                  enable_cloud_sync,
+                  std::move(auth_url));
 
     auto ditto =
         std::make_shared<ditto::Ditto>(identity, std::move(persistence_dir));
+    if (transport.offline_identity &&
+        !transport.offline_license_token.empty()) {
+      ditto->set_offline_only_license_token(transport.offline_license_token);
+    }
 
-    ditto->update_transport_config([websocket_url](ditto::TransportConfig &config) {
-      config.enable_all_peer_to_peer();
-      config.connect.websocket_urls.insert(websocket_url);
-    });
+    ditto->update_transport_config(
+        [&transport, &websocket_url](ditto::TransportConfig &config) {
+          apply_transport_options(config, transport, websocket_url);
+        });
 
     // Required for compatibility with DQL.
     ditto->disable_sync_with_v3();
@@ -81,12 +200,112 @@ static shared_ptr<ditto::Ditto> init_ditto(string app_id,
   }
 }
 
+/// Build a DQL query that selects the tasks matching `filter`, in the given
+/// order.  The filter's values are added to `args` as query parameters rather
+/// than embedded in the query text.
+static string observe_query(const TaskFilter &filter, TaskSort sort,
+                            size_t limit, json &args) {
+  vector<string> conditions;
+  if (!filter.include_deleted) {
+    conditions.emplace_back("NOT deleted");
+  }
+  if (filter.id) {
+    conditions.emplace_back("_id = :id");
+    args["id"] = *filter.id;
+  }
+  if (filter.done) {
+    conditions.emplace_back("done = :done");
+    args["done"] = *filter.done;
+  }
+  if (filter.title_contains) {
+    conditions.emplace_back("contains(title, :title)");
+    args["title"] = *filter.title_contains;
+  }
+
+  string query = "SELECT * FROM tasks";
+  for (size_t i = 0; i < conditions.size(); ++i) {
+    query += (i == 0 ? " WHERE " : " AND ") + conditions[i];
+  }
+  switch (sort) {
+  case TaskSort::Id:
+    query += " ORDER BY _id";
+    break;
+  case TaskSort::Title:
+    query += " ORDER BY title, _id";
+    break;
+  case TaskSort::RecentlyModified:
+    query += " ORDER BY modified_at DESC, _id";
+    break;
+  }
+  if (limit > 0) {
+    query += " LIMIT " + to_string(limit);
+  }
+  return query;
+}
+
+/// Number of items read by each statement when a query is paged by
+/// `execute_dql_query_streaming()`.
+static constexpr size_t STREAMING_PAGE_SIZE = 1000;
+
+/// If `query` has the form `SELECT * FROM collection [WHERE condition]`,
+/// return a query that reads one page of its result in `_id` order: the items
+/// whose `_id` is greater than the `:afterId` parameter (or all items if
+/// `first_page` is set), limited to STREAMING_PAGE_SIZE.
+///
+/// Otherwise return an empty string, as the query cannot be paged by `_id`
+/// without changing its result: it sorts, limits, groups or projects it.
+static string paged_query(const string &query, bool first_page) {
+  static const regex select_all(
+      R"(^\s*SELECT\s+\*\s+FROM\s+(\w+)(?:\s+WHERE\s+([\s\S]+?))?\s*;?\s*$)",
+      regex::icase);
+  static const regex not_pageable(R"(\b(ORDER|LIMIT|OFFSET|GROUP)\b)",
+                                  regex::icase);
+  smatch match;
+  if (!regex_match(query, match, select_all)) {
+    return "";
+  }
+  const string condition = match[2].matched ? match[2].str() : "";
+  if (regex_search(condition, not_pageable)) {
+    return "";
+  }
+
+  vector<string> conditions;
+  if (!condition.empty()) {
+    conditions.push_back("(" + condition + ")");
+  }
+  if (!first_page) {
+    conditions.emplace_back("_id > :afterId");
+  }
+  string paged = "SELECT * FROM " + match[1].str();
+  for (size_t i = 0; i < conditions.size(); ++i) {
+    paged += (i == 0 ? " WHERE " : " AND ") + conditions[i];
+  }
+  return paged + " ORDER BY _id LIMIT " + to_string(STREAMING_PAGE_SIZE);
+}
+
 // Private implementation of the TasksPeer class.
 class TasksPeer::Impl { // NOLINT(cppcoreguidelines-special-member-functions)
 private:
   shared_ptr<mutex> mtx;
   shared_ptr<ditto::Ditto> ditto;
-  shared_ptr<ditto::SyncSubscription> tasks_subscription;
+  vector<string> subscription_queries{TasksPeer::subscription_query_all()};
+  vector<shared_ptr<ditto::SyncSubscription>> tasks_subscriptions;
+  unique_ptr<RetentionEngine> retention;
+  shared_ptr<TaskCounter> counter{make_shared<TaskCounter>()};
+  shared_ptr<ditto::StoreObserver> counter_observer; // guarded by mtx
+  unique_ptr<WriteBuffer> write_buffer;
+  string persistence_directory;
+
+  // The subscription for recently modified tasks, if any, is one of
+  // subscription_queries, with a cutoff that subscription_refresher moves
+  // forward.  recent_window and recent_query are guarded by mtx, and the
+  // other members in this group by refresher_mtx.
+  optional<chrono::seconds> recent_window;
+  string recent_query;
+  mutex refresher_mtx;
+  condition_variable refresher_cv;
+  bool refresher_stopping = false;
+  thread subscription_refresher;
 
   string select_tasks_query(bool include_deleted_tasks = false) {
     if (include_deleted_tasks) {
@@ -103,7 +322,8 @@ public:
     string websocket_url,
     string auth_url,
     bool enable_cloud_sync,
-    string persistence_dir)
+    string persistence_dir,
+    const TransportOptions &transport)
       : mtx(new mutex()),
         ditto(
           init_ditto(
@@ -112,10 +332,25 @@ public:
             std::move(websocket_url), 
             std::move(auth_url),
             enable_cloud_sync,    // This is required to be set to false to use the correct URLs
-            std::move(persistence_dir))) {}
+            persistence_dir,
+            transport)),
+        persistence_directory(std::move(persistence_dir)) {
+    create_indexes();
+  }
 
   ~Impl() noexcept {
     try {
+      if (subscription_refresher.joinable()) {
+        {
+          lock_guard<mutex> lock(refresher_mtx);
+          refresher_stopping = true;
+        }
+        refresher_cv.notify_all();
+        subscription_refresher.join();
+      }
+      write_buffer.reset();
+      counter_observer.reset();
+      retention.reset();
       stop_sync();
     } catch (const exception &err) {
       std::cerr << "Failed to destroy tasks peer instance: " +
@@ -124,32 +359,406 @@ public:
     }
   }
 
+  void create_indexes() {
+    lock_guard<mutex> lock(*mtx);
+
+    // Indexes only affect performance, so a failure is logged rather than
+    // preventing the peer from being used.
+    for (const auto &stmt : index_statements) {
+      try {
+        ditto->get_store().execute(stmt);
+      } catch (const exception &err) {
+        log_warning("Failed to create index (" + stmt +
+                    "): " + string(err.what()));
+      }
+    }
+    log_debug("Created indexes");
+  }
+
+  void start_counting() {
+    try {
+      lock_guard<mutex> lock(*mtx);
+      if (counter_observer) {
+        return;
+      }
+
+      // The initial count uses `count_tasks()`, so that `stats()` is correct
+      // from here on rather than only after the observer's first callback.
+      const auto initial = count_tasks();
+      {
+        lock_guard<mutex> counter_lock(counter->mtx);
+        counter->stats = initial;
+      }
+
+      // The observer only reads the three small properties that determine a
+      // task's state, and reuses a single Task for decoding them, but it
+      // still reads every task each time the collection changes.
+      counter_observer = ditto->get_store().register_observer(
+          count_tasks_query,
+          [counter = counter, scratch = make_shared<Task>()](
+              const ditto::QueryResult &result) {
+            const auto stats = tally_tasks(result, *scratch);
+            lock_guard<mutex> counter_lock(counter->mtx);
+            counter->stats = stats;
+          });
+      log_debug("Registered task counter; total=" +
+                to_string(initial.total()));
+    } catch (const exception &err) {
+      log_warning("Failed to start counting tasks: " + string(err.what()));
+    }
+  }
+
+  void stop_counting() {
+    lock_guard<mutex> lock(*mtx);
+    if (counter_observer) {
+      counter_observer.reset();
+      log_debug("Unregistered task counter");
+    }
+  }
+
+  TaskStats stats() const {
+    lock_guard<mutex> lock(counter->mtx);
+    return counter->stats;
+  }
+
+  TaskStats count_tasks() const {
+    try {
+      // The store counts the documents itself, so no task is decoded here.
+      auto &store = ditto->get_store();
+      TaskStats counts;
+      const auto total =
+          count_from(store.execute("SELECT COUNT(*) AS count FROM tasks"));
+      counts.deleted = count_from(store.execute(
+          "SELECT COUNT(*) AS count FROM tasks WHERE deleted = true"));
+      counts.done = count_from(store.execute(
+          "SELECT COUNT(*) AS count FROM tasks"
+          " WHERE done = true AND NOT deleted"));
+      counts.open = total - min(total, counts.deleted + counts.done);
+      return counts;
+    } catch (const exception &err) {
+      log_error("Failed to count tasks: " + string(err.what()));
+      throw runtime_error("unable to count tasks: " + string(err.what()));
+    }
+  }
+
+  StorageReport storage_report(size_t sample_size) {
+    try {
+      StorageReport report;
+      report.timestamp = task_timestamp_now();
+      report.persistence_directory = persistence_directory;
+      report.disk_bytes =
+          directory_size(persistence_directory, report.disk_files);
+      const auto counts = count_tasks();
+      report.live_documents = counts.open + counts.done;
+      report.tombstones = counts.deleted;
+
+      // The query has no ORDER BY, so the store can stop once it has found
+      // `sample_size` documents, however many there are in total.  Those are
+      // the first in the store's order, not a random sample.
+      vector<size_t> sizes;
+      vector<TitleSize> titles;
+      {
+        lock_guard<mutex> lock(*mtx);
+        const auto result = ditto->get_store().execute(
+            "SELECT * FROM tasks LIMIT " + to_string(sample_size));
+        const auto item_count = result.item_count();
+        sizes.reserve(item_count);
+        titles.reserve(item_count);
+        Task task;
+        for (size_t i = 0; i < item_count; ++i) {
+          const auto doc = result.get_item(i).json_string();
+          sizes.push_back(doc.size());
+          from_json_string(doc, task);
+          titles.push_back({task._id, task.title.size()});
+        }
+      }
+
+      report.sampled_documents = sizes.size();
+      report.sampled_all = sizes.size() >= counts.total();
+      if (!sizes.empty()) {
+        sort(sizes.begin(), sizes.end());
+        size_t total = 0;
+        for (const auto size : sizes) {
+          total += size;
+        }
+        report.average_document_bytes =
+            static_cast<double>(total) / sizes.size();
+        report.p99_document_bytes =
+            sizes[min(sizes.size() - 1, sizes.size() * 99 / 100)];
+        report.max_document_bytes = sizes.back();
+      }
+
+      const auto top = min(titles.size(), LARGEST_TITLE_COUNT);
+      partial_sort(titles.begin(), titles.begin() + top, titles.end(),
+                   [](const TitleSize &a, const TitleSize &b) {
+                     return a.bytes > b.bytes;
+                   });
+      titles.resize(top);
+      report.largest_titles = std::move(titles);
+
+      log_debug("Built storage report; sampled=" +
+                to_string(report.sampled_documents) +
+                (report.sampled_all ? "" : " (prefix)"));
+      return report;
+    } catch (const exception &err) {
+      log_error("Failed to build storage report: " + string(err.what()));
+      throw runtime_error("unable to build storage report: " +
+                          string(err.what()));
+    }
+  }
+
+  string explain_query(const string &query) {
+    try {
+      lock_guard<mutex> lock(*mtx);
+
+      const auto result = ditto->get_store().execute("EXPLAIN " + query);
+      string plan;
+      const auto item_count = result.item_count();
+      for (size_t i = 0; i < item_count; ++i) {
+        if (i > 0) {
+          plan += '\n';
+        }
+        plan += json::parse(result.get_item(i).json_string()).dump(2);
+      }
+      log_debug("Explained DQL query");
+      return plan;
+    } catch (const exception &err) {
+      log_error("Failed to explain DQL query: " + string(err.what()));
+      throw runtime_error("unable to explain DQL query: " + string(err.what()));
+    }
+  }
+
   void start_sync() {
     if (is_sync_active()) {
       return;
     }
 
     ditto->start_sync();
-    tasks_subscription =
-        ditto->sync().register_subscription("SELECT * FROM tasks");
+    lock_guard<mutex> lock(*mtx);
+    for (const auto &query : subscription_queries) {
+      tasks_subscriptions.push_back(
+          ditto->sync().register_subscription(query));
+    }
   }
 
   void stop_sync() {
+    flush_writes();
     if (!is_sync_active()) {
       return;
     }
 
-    tasks_subscription->cancel();
-    tasks_subscription.reset();
+    {
+      lock_guard<mutex> lock(*mtx);
+      for (const auto &subscription : tasks_subscriptions) {
+        subscription->cancel();
+      }
+      tasks_subscriptions.clear();
+    }
     ditto->stop_sync();
   }
 
+  void set_subscriptions(vector<string> queries,
+                         optional<chrono::seconds> recent) {
+    try {
+      if (queries.empty() && !recent) {
+        throw invalid_argument("at least one subscription is required");
+      }
+      {
+        lock_guard<mutex> lock(*mtx);
+        recent_window = recent;
+        recent_query.clear();
+        if (recent) {
+          recent_query =
+              TasksPeer::subscription_query_modified_within(*recent);
+          queries.push_back(recent_query);
+        }
+        replace_subscriptions(std::move(queries));
+      }
+      if (recent) {
+        lock_guard<mutex> lock(refresher_mtx);
+        if (!subscription_refresher.joinable()) {
+          subscription_refresher =
+              thread([this] { refresh_subscriptions(); });
+        }
+      }
+    } catch (const exception &err) {
+      log_error("Failed to set subscriptions: " + string(err.what()));
+      throw runtime_error("unable to set subscriptions: " +
+                          string(err.what()));
+    }
+  }
+
+  /// Body of subscription_refresher, which moves the cutoff of the recent
+  /// subscription forward periodically, so that it covers a sliding window
+  /// rather than every task modified since it was set.
+  void refresh_subscriptions() {
+    unique_lock<mutex> refresher_lock(refresher_mtx);
+    for (;;) {
+      chrono::seconds interval{60};
+      {
+        lock_guard<mutex> lock(*mtx);
+        if (recent_window) {
+          interval = clamp(*recent_window / RECENT_REFRESHES_PER_WINDOW,
+                           chrono::seconds(1), chrono::seconds(3600));
+        }
+      }
+      if (refresher_cv.wait_for(refresher_lock, interval,
+                                [this] { return refresher_stopping; })) {
+        return;
+      }
+      try {
+        lock_guard<mutex> lock(*mtx);
+        if (!recent_window) {
+          continue;
+        }
+        auto queries = subscription_queries;
+        const auto next =
+            TasksPeer::subscription_query_modified_within(*recent_window);
+        replace(queries.begin(), queries.end(), recent_query, next);
+        replace_subscriptions(std::move(queries));
+        recent_query = next;
+      } catch (const exception &err) {
+        log_warning("Failed to refresh the recent subscription: " +
+                    string(err.what()));
+      }
+    }
+  }
+
+  /// Replace the subscription queries, and if sync is active, the
+  /// subscriptions.  The caller must hold mtx.
+  void replace_subscriptions(vector<string> queries) {
+    if (tasks_subscriptions.empty()) {
+      // Not syncing; the queries are registered by start_sync().
+      subscription_queries = std::move(queries);
+      return;
+    }
+
+    // Register all the new subscriptions before cancelling any old ones, so
+    // that documents matched by both are never out of scope.  Unchanged
+    // subscriptions are kept as they are.
+    vector<shared_ptr<ditto::SyncSubscription>> subscriptions;
+    for (const auto &query : queries) {
+      const auto existing = find(subscription_queries.begin(),
+                                 subscription_queries.end(), query);
+      if (existing != subscription_queries.end()) {
+        const auto index = existing - subscription_queries.begin();
+        subscriptions.push_back(tasks_subscriptions[index]);
+      } else {
+        subscriptions.push_back(ditto->sync().register_subscription(query));
+      }
+    }
+    for (const auto &subscription : tasks_subscriptions) {
+      if (find(subscriptions.begin(), subscriptions.end(), subscription) ==
+          subscriptions.end()) {
+        subscription->cancel();
+      }
+    }
+    subscription_queries = std::move(queries);
+    tasks_subscriptions = std::move(subscriptions);
+    log_debug("Replaced sync subscriptions; count=" +
+              to_string(tasks_subscriptions.size()));
+  }
+
+  vector<string> get_subscriptions() const {
+    lock_guard<mutex> lock(*mtx);
+    return subscription_queries;
+  }
+
   bool is_sync_active() const { return ditto->get_is_sync_active(); }
 
+  void set_write_behind(chrono::milliseconds window, size_t max_pending) {
+    // Destroying the current buffer writes its pending changes.
+    write_buffer.reset();
+    if (window.count() > 0) {
+      write_buffer = make_unique<WriteBuffer>(
+          window, max_pending,
+          [this](const TaskChanges &changes) {
+            return write_changes(changes);
+          });
+    }
+  }
+
+  void flush_writes() {
+    if (write_buffer) {
+      write_buffer->flush();
+    }
+  }
+
+  WriteBufferStats write_behind_stats() const {
+    return write_buffer ? write_buffer->stats() : WriteBufferStats{};
+  }
+
+  /// Write a group of buffered changes, with one statement per task.
+  ///
+  /// Each statement is an `UPDATE` of only the changed properties, so it
+  /// never recreates a task that has been evicted since it was changed, and
+  /// leaves the other properties as they are in the store.
+  WriteOutcome write_changes(const TaskChanges &changes) {
+    lock_guard<mutex> lock(*mtx);
+    auto &store = ditto->get_store();
+
+    WriteOutcome outcome;
+    for (const auto &entry : changes) {
+      const auto &change = entry.second;
+      string stmt = "UPDATE tasks SET modified_at = :modifiedAt";
+      json args = {{"id", entry.first}, {"modifiedAt", change.modified_at}};
+      if (change.title) {
+        stmt += ", title = :title";
+        args["title"] = *change.title;
+      }
+      if (change.done) {
+        stmt += ", done = :done";
+        args["done"] = *change.done;
+      }
+      if (change.deleted) {
+        stmt += ", deleted = :deleted";
+        args["deleted"] = *change.deleted;
+      }
+      stmt += " WHERE _id = :id";
+      try {
+        const auto result = store.execute(stmt, args);
+        if (result.mutated_document_ids().empty()) {
+          log_warning("Discarded buffered changes to missing task: " +
+                      entry.first);
+          ++outcome.missing;
+        } else {
+          ++outcome.written;
+        }
+      } catch (const exception &err) {
+        log_error("Failed to write buffered changes to task " + entry.first +
+                  ": " + string(err.what()));
+        ++outcome.failed;
+      }
+    }
+    log_debug("Wrote buffered changes; count=" + to_string(outcome.written));
+    return outcome;
+  }
+
+  /// Add a change to the write buffer, if write-behind is enabled.
+  ///
+  /// @return true if the change was buffered, or false if it must be written
+  /// directly.
+  bool buffer_change(const string &task_id, TaskChange change) {
+    if (!write_buffer) {
+      return false;
+    }
+    if (task_id.empty()) {
+      throw invalid_argument("task ID must not be empty");
+    }
+    change.modified_at = task_timestamp_now();
+    write_buffer->add(task_id, change);
+    log_debug("Buffered change to task: " + task_id);
+    return true;
+  }
+
   string add_task(const string &title, bool done) {
     try {
-      const json task_args = {
-          {"title", title}, {"done", done}, {"deleted", false}};
+      const auto now = task_timestamp_now();
+      const json task_args = {{"title", title},
+                              {"done", done},
+                              {"deleted", false},
+                              {"created_at", now},
+                              {"modified_at", now}};
       const auto command = "INSERT INTO tasks DOCUMENTS (:newTask)";
       const auto result =
           ditto->get_store().execute(command, {{"newTask", task_args}});
@@ -164,9 +773,14 @@ public:
 
   vector<Task> get_tasks(bool include_deleted_tasks) {
     try {
+      // The lock keeps buffered changes from being written between the query
+      // and the overlay, which would leave them out of the result.
+      lock_guard<mutex> lock(*mtx);
+
       const auto result =
           ditto->get_store().execute(select_tasks_query(include_deleted_tasks));
-      const auto tasks = tasks_from(result);
+      auto tasks = tasks_from(result);
+      overlay_pending(write_buffer.get(), tasks, include_deleted_tasks);
       log_debug("Retrieved tasks; count=" + to_string(tasks.size()));
       return tasks;
     } catch (const exception &err) {
@@ -175,6 +789,32 @@ public:
     }
   }
 
+  vector<Task> get_tasks_modified_since(int64_t since, size_t limit,
+                                        const string &after_id) {
+    try {
+      flush_writes();
+      lock_guard<mutex> lock(*mtx);
+
+      // The first condition is a range on the `modified_at` index; the second
+      // skips tasks at exactly `since` that an earlier page has returned.
+      const auto query = "SELECT * FROM tasks"
+                         " WHERE modified_at >= :since"
+                         " AND (modified_at > :since OR _id > :afterId)"
+                         " ORDER BY modified_at, _id"
+                         " LIMIT " +
+                         to_string(limit);
+      const auto result = ditto->get_store().execute(
+          query, {{"since", since}, {"afterId", after_id}});
+      auto tasks = tasks_from(result);
+      log_debug("Retrieved tasks modified since " + to_string(since) +
+                "; count=" + to_string(tasks.size()));
+      return tasks;
+    } catch (const exception &err) {
+      log_error("Failed to get modified tasks: " + string(err.what()));
+      throw runtime_error("unable to get tasks: " + string(err.what()));
+    }
+  }
+
   Task get_task(const string &task_id) {
     try {
       lock_guard<mutex> lock(*mtx);
@@ -193,7 +833,11 @@ public:
                             "\"");
       }
 
-      const auto task = task_from(result.get_item(0));
+      auto task = task_from(result.get_item(0));
+      if (write_buffer && write_buffer->overlay(task) && task.deleted) {
+        throw runtime_error(string("no tasks found with id \"") + task_id +
+                            "\"");
+      }
       log_debug("Retrieved task with _id " + task_id);
       return task;
     } catch (const exception &err) {
@@ -225,6 +869,10 @@ public:
       }
 
       auto task = task_from(result.get_item(0));
+      if (write_buffer && write_buffer->overlay(task) && task.deleted) {
+        throw runtime_error(string("no tasks found with id containing \"") +
+                            task_id_substring + "\"");
+      }
       log_debug("Found matching task for " + task_id_substring + ": " +
                 task._id);
       return task;
@@ -237,18 +885,28 @@ public:
 
   void update_task(const Task &task) {
     try {
+      TaskChange change;
+      change.title = task.title;
+      change.done = task.done;
+      change.deleted = task.deleted;
+      if (buffer_change(task._id, change)) {
+        return;
+      }
+
       lock_guard<mutex> lock(*mtx);
 
       const auto stmt = "UPDATE tasks SET"
                         " title = :title,"
                         " done = :done,"
-                        " deleted = :deleted"
+                        " deleted = :deleted,"
+                        " modified_at = :modifiedAt"
                         " WHERE _id = :id";
-      const auto result =
-          ditto->get_store().execute(stmt, {{"title", task.title},
-                                            {"done", task.done},
-                                            {"deleted", task.deleted},
-                                            {"id", task._id}});
+      const auto result = ditto->get_store().execute(
+          stmt, {{"title", task.title},
+                 {"done", task.done},
+                 {"deleted", task.deleted},
+                 {"modifiedAt", task_timestamp_now()},
+                 {"id", task._id}});
       if (result.mutated_document_ids().empty()) {
         throw runtime_error("task not found with ID: " + task._id);
       }
@@ -261,15 +919,24 @@ public:
 
   void mark_task_complete(const string &task_id, bool done) {
     try {
+      TaskChange change;
+      change.done = done;
+      if (buffer_change(task_id, change)) {
+        return;
+      }
+
       lock_guard<mutex> lock(*mtx);
 
       if (task_id.empty()) {
         throw invalid_argument("task ID must not be empty");
       }
 
-      const auto stmt = "UPDATE tasks SET done = :done WHERE _id = :id";
-      const auto result =
-          ditto->get_store().execute(stmt, {{"done", done}, {"id", task_id}});
+      const auto stmt = "UPDATE tasks SET done = :done,"
+                        " modified_at = :modifiedAt WHERE _id = :id";
+      const auto result = ditto->get_store().execute(
+          stmt, {{"done", done},
+                 {"modifiedAt", task_timestamp_now()},
+                 {"id", task_id}});
       log_debug("Marked task " + task_id +
                 (done ? " complete" : " incomplete"));
     } catch (const exception &err) {
@@ -279,17 +946,170 @@ public:
     }
   }
 
-  void update_task_title(const string &task_id, const string &title) {
+  bool toggle_task(const string &task_id) {
     try {
+      flush_writes();
       lock_guard<mutex> lock(*mtx);
 
       if (task_id.empty()) {
         throw invalid_argument("task ID must not be empty");
       }
 
-      const auto stmt = "UPDATE tasks SET title = :title WHERE _id = :id";
+      // An UPDATE reports only which documents it changed, so `SET done = NOT
+      // done` could not tell the caller the new status.  Instead, each
+      // statement sets one status, only if the task has the other one, and
+      // whether it changed the task gives the new status.  The task is only
+      // read by the statements themselves.  A task with no `done` property is
+      // treated as not done.  If neither statement matches, the task was
+      // deleted, or toggled by another peer in between; that is retried once.
+      const auto stmt = "UPDATE tasks SET done = :done,"
+                        " modified_at = :modifiedAt"
+                        " WHERE _id = :id AND NOT deleted"
+                        " AND coalesce(done, false) = :expectedDone";
+      for (int attempt = 0; attempt < TOGGLE_ATTEMPTS; ++attempt) {
+        for (const bool done : {true, false}) {
+          const auto result = ditto->get_store().execute(
+              stmt, {{"done", done},
+                     {"modifiedAt", task_timestamp_now()},
+                     {"id", task_id},
+                     {"expectedDone", !done}});
+          if (!result.mutated_document_ids().empty()) {
+            log_debug("Toggled task " + task_id +
+                      (done ? " complete" : " incomplete"));
+            return done;
+          }
+        }
+      }
+      throw runtime_error("task not found with ID: " + task_id);
+    } catch (const exception &err) {
+      log_error("Failed to toggle task: " + string(err.what()));
+      throw runtime_error("unable to toggle task: " + string(err.what()));
+    }
+  }
+
+  optional<Task> update_task_if(const Task &expected, const Task &desired) {
+    try {
+      flush_writes();
+      lock_guard<mutex> lock(*mtx);
+
+      if (expected._id.empty()) {
+        throw invalid_argument("task ID must not be empty");
+      }
+
+      const auto stmt = "UPDATE tasks SET"
+                        " title = :title,"
+                        " done = :done,"
+                        " deleted = :deleted,"
+                        " modified_at = :modifiedAt"
+                        " WHERE _id = :id"
+                        " AND title = :expectedTitle"
+                        " AND done = :expectedDone"
+                        " AND deleted = :expectedDeleted";
+      const auto now = task_timestamp_now();
+      const auto result = ditto->get_store().execute(
+          stmt, {{"title", desired.title},
+                 {"done", desired.done},
+                 {"deleted", desired.deleted},
+                 {"modifiedAt", now},
+                 {"id", expected._id},
+                 {"expectedTitle", expected.title},
+                 {"expectedDone", expected.done},
+                 {"expectedDeleted", expected.deleted}});
+      if (result.mutated_document_ids().empty()) {
+        log_debug("Conditional update did not match task: " + expected._id);
+        return nullopt;
+      }
+
+      // The statement set every property that can change, so the post-image
+      // is known without reading it back.
+      log_debug("Conditionally updated task: " + expected._id);
+      Task updated = expected;
+      updated.title = desired.title;
+      updated.done = desired.done;
+      updated.deleted = desired.deleted;
+      updated.modified_at = now;
+      return updated;
+    } catch (const exception &err) {
+      log_error("Failed to conditionally update task: " + string(err.what()));
+      throw runtime_error("unable to update task: " + string(err.what()));
+    }
+  }
+
+  Task upsert_task(const Task &task) {
+    try {
+      flush_writes();
+      lock_guard<mutex> lock(*mtx);
+
+      // The conflict update replaces every property in the document, so a
+      // task given without a creation time takes the stored one, if there
+      // is a stored task, rather than being recreated now.  A stored task
+      // that has no creation time keeps none.
+      const auto now = task_timestamp_now();
+      auto created_at = task.created_at;
+      bool stored_before = false;
+      if (created_at == 0 && !task._id.empty()) {
+        const auto existing = ditto->get_store().execute(
+            "SELECT created_at FROM tasks WHERE _id = :id",
+            {{"id", task._id}});
+        if (existing.item_count() > 0) {
+          stored_before = true;
+          created_at = json::parse(existing.get_item(0).json_string())
+                           .value("created_at", static_cast<int64_t>(0));
+        }
+      }
+      if (created_at == 0 && !stored_before) {
+        created_at = now;
+      }
+      json task_args = {{"title", task.title},
+                        {"done", task.done},
+                        {"deleted", task.deleted},
+                        {"modified_at", now}};
+      if (created_at != 0) {
+        task_args["created_at"] = created_at;
+      }
+      if (!task._id.empty()) {
+        task_args["_id"] = task._id;
+      }
+      const auto command =
+          "INSERT INTO tasks DOCUMENTS (:task) ON ID CONFLICT DO UPDATE";
       const auto result =
-          ditto->get_store().execute(stmt, {{"title", title}, {"id", task_id}});
+          ditto->get_store().execute(command, {{"task", task_args}});
+      if (result.mutated_document_ids().empty()) {
+        throw runtime_error("no document was inserted or updated");
+      }
+
+      Task stored = task;
+      stored._id = result.mutated_document_ids()[0].to_string();
+      stored.created_at = created_at;
+      stored.modified_at = now;
+      log_debug("Upserted task: " + stored._id);
+      return stored;
+    } catch (const exception &err) {
+      log_error("Failed to upsert task: " + string(err.what()));
+      throw runtime_error("unable to upsert task: " + string(err.what()));
+    }
+  }
+
+  void update_task_title(const string &task_id, const string &title) {
+    try {
+      TaskChange change;
+      change.title = title;
+      if (buffer_change(task_id, change)) {
+        return;
+      }
+
+      lock_guard<mutex> lock(*mtx);
+
+      if (task_id.empty()) {
+        throw invalid_argument("task ID must not be empty");
+      }
+
+      const auto stmt = "UPDATE tasks SET title = :title,"
+                        " modified_at = :modifiedAt WHERE _id = :id";
+      const auto result = ditto->get_store().execute(
+          stmt, {{"title", title},
+                 {"modifiedAt", task_timestamp_now()},
+                 {"id", task_id}});
       if (result.mutated_document_ids().empty()) {
         throw runtime_error("task not found with ID: " + task_id);
       }
@@ -300,16 +1120,126 @@ public:
     }
   }
 
+  uint64_t attach_task_body(const string &task_id, const string &path) {
+    try {
+      flush_writes();
+      lock_guard<mutex> lock(*mtx);
+
+      if (task_id.empty()) {
+        throw invalid_argument("task ID must not be empty");
+      }
+      if (!filesystem::is_regular_file(path)) {
+        throw invalid_argument("not a readable file: " + path);
+      }
+
+      auto &store = ditto->get_store();
+      const auto body = store.new_attachment(
+          path, {{"name", filesystem::path(path).filename().string()}});
+      const auto stmt = "UPDATE COLLECTION tasks (body ATTACHMENT)"
+                        " SET body = :body, modified_at = :modifiedAt"
+                        " WHERE _id = :id AND NOT deleted";
+      const auto result = store.execute(
+          stmt, {{"body", body.to_json()},
+                 {"modifiedAt", task_timestamp_now()},
+                 {"id", task_id}});
+      if (result.mutated_document_ids().empty()) {
+        throw runtime_error("task not found with ID: " + task_id);
+      }
+      log_debug("Attached body to task " + task_id +
+                "; size=" + to_string(body.len()));
+      return body.len();
+    } catch (const exception &err) {
+      log_error("Failed to attach task body: " + string(err.what()));
+      throw runtime_error("unable to attach task body: " + string(err.what()));
+    }
+  }
+
+  shared_ptr<ditto::AttachmentFetcher>
+  fetch_task_body(const string &task_id, TaskBodyFetchHandlers handlers) {
+    try {
+      lock_guard<mutex> lock(*mtx);
+
+      if (task_id.empty()) {
+        throw invalid_argument("task ID must not be empty");
+      }
+
+      // Only the attachment token is needed, not the rest of the task.
+      auto &store = ditto->get_store();
+      const auto query =
+          "SELECT body FROM tasks WHERE _id = :id AND NOT deleted";
+      const auto result = store.execute(query, {{"id", task_id}});
+      if (result.item_count() == 0) {
+        throw runtime_error("task not found with ID: " + task_id);
+      }
+      const auto doc = json::parse(result.get_item(0).json_string());
+      const auto body = doc.find("body");
+      if (body == doc.end() || !body->is_object()) {
+        throw runtime_error("task has no body: " + task_id);
+      }
+
+      const ditto::AttachmentToken token(*body);
+      auto fetcher = store.fetch_attachment(
+          token, [task_id, handlers = std::move(handlers)](
+                     unique_ptr<ditto::AttachmentFetchEvent> event) {
+            try {
+              switch (event->type) {
+              case ditto::AttachmentFetchEventType::Progress:
+                if (handlers.on_progress) {
+                  const auto &progress =
+                      static_cast<const ditto::AttachmentFetchEventProgress &>(
+                          *event);
+                  handlers.on_progress(progress.downloaded_bytes,
+                                       progress.total_bytes);
+                }
+                break;
+              case ditto::AttachmentFetchEventType::Completed:
+                log_debug("Fetched body of task " + task_id);
+                if (handlers.on_complete) {
+                  const auto &completed =
+                      static_cast<const ditto::AttachmentFetchEventCompleted &>(
+                          *event);
+                  handlers.on_complete(completed.attachment);
+                }
+                break;
+              case ditto::AttachmentFetchEventType::Deleted:
+                log_warning("Body of task " + task_id +
+                            " was deleted before it was fetched");
+                if (handlers.on_deleted) {
+                  handlers.on_deleted();
+                }
+                break;
+              }
+            } catch (const exception &err) {
+              log_error("Error in task body fetch handler: " +
+                        string(err.what()));
+            }
+          });
+      log_debug("Fetching body of task " + task_id);
+      return fetcher;
+    } catch (const exception &err) {
+      log_error("Failed to fetch task body: " + string(err.what()));
+      throw runtime_error("unable to fetch task body: " + string(err.what()));
+    }
+  }
+
   void delete_task(const string &task_id) {
     try {
+      TaskChange change;
+      change.deleted = true;
+      if (buffer_change(task_id, change)) {
+        return;
+      }
+
       lock_guard<mutex> lock(*mtx);
 
       if (task_id.empty()) {
         throw invalid_argument("task ID must not be empty");
       }
 
-      const auto stmt = "UPDATE tasks SET deleted = true WHERE _id = :id";
-      const auto result = ditto->get_store().execute(stmt, {{"id", task_id}});
+      const auto stmt = "UPDATE tasks SET deleted = true,"
+                        " modified_at = :modifiedAt WHERE _id = :id";
+      const auto result = ditto->get_store().execute(
+          stmt, {{"modifiedAt", task_timestamp_now()}, {"id", task_id}});
       if (result.mutated_document_ids().empty()) {
         throw runtime_error("task not found with ID: " + task_id);
       }
@@ -320,8 +1250,29 @@ public:
     }
   }
 
+  void set_retention_policy(const RetentionPolicy &policy) {
+    try {
+      // Stop the current engine (waiting for its batch) before starting a new
+      // one, so that two engines never run at once.
+      retention.reset();
+      if (policy.enabled()) {
+        retention = make_unique<RetentionEngine>(ditto, mtx, policy);
+        log_debug("Started retention engine");
+      }
+    } catch (const exception &err) {
+      log_error("Failed to set retention policy: " + string(err.what()));
+      throw runtime_error("unable to set retention policy: " +
+                          string(err.what()));
+    }
+  }
+
+  RetentionStats retention_stats() const {
+    return retention ? retention->stats() : RetentionStats{};
+  }
+
   void evict_deleted_tasks() {
     try {
+      flush_writes();
       lock_guard<mutex> lock(*mtx);
 
       const auto stmt = "EVICT FROM tasks WHERE deleted = true";
@@ -333,26 +1284,43 @@ public:
     }
   }
 
-  shared_ptr<ditto::StoreObserver> register_tasks_observer(
-      std::function<void(const std::vector<Task> &)> callback) {
+  shared_ptr<ditto::StoreObserver>
+  observe(const TaskFilter &filter, TaskSort sort, size_t limit,
+          std::function<void(const std::vector<Task> &)> callback) {
     try {
+      auto args = json::object();
+      const auto query = observe_query(filter, sort, limit, args);
+
+      // Ditto does not invoke an observer's callback concurrently with
+      // itself, so the decoded tasks can be recycled from one invocation to
+      // the next.
+      auto tasks = make_shared<vector<Task>>();
       const auto observer = ditto->get_store().register_observer(
-          select_tasks_query(),
-          [callback = std::move(callback)](const ditto::QueryResult &result) {
-            const auto item_count = result.item_count();
-            log_debug("Tasks collection updated; count=" +
-                      to_string(item_count));
-            const auto tasks = tasks_from(result);
+          query, args,
+          [callback = std::move(callback),
+           tasks](const ditto::QueryResult &result) {
+            // Avoid building log messages unless they will be logged, so
+            // that steady-state delivery does not allocate.
+            const auto debug = is_log_debug_enabled();
+            if (debug) {
+              log_debug("Tasks collection updated; count=" +
+                        to_string(result.item_count()));
+            }
+            tasks_from(result, *tasks);
             try {
-              log_debug("Invoking observer callback");
-              callback(tasks);
-              log_debug("Observer callback completed");
+              if (debug) {
+                log_debug("Invoking observer callback");
+              }
+              callback(*tasks);
+              if (debug) {
+                log_debug("Observer callback completed");
+              }
             } catch (const exception &err) {
               log_error("Error in observer callback: " + string(err.what()));
             }
           });
 
-      log_debug("Registered tasks observer");
+      log_debug("Registered tasks observer: " + query);
       return observer;
     } catch (const exception &err) {
       log_error("Failed to register observer: " + string(err.what()));
@@ -362,6 +1330,7 @@ public:
 
   string execute_dql_query(const string &query) {
     try {
+      flush_writes();
       lock_guard<mutex> lock(*mtx);
 
       const auto result = ditto->get_store().execute(query);
@@ -373,6 +1342,53 @@ public:
     }
   }
 
+  size_t execute_dql_query_streaming(
+      const string &query,
+      const function<void(const ditto::QueryResultItem &)> &visitor) {
+    try {
+      flush_writes();
+      lock_guard<mutex> lock(*mtx);
+
+      if (paged_query(query, true).empty()) {
+        const auto result = ditto->get_store().execute(query);
+        const auto item_count = result.item_count();
+        log_debug("Executed DQL query; count=" + to_string(item_count));
+        for (size_t i = 0; i < item_count; ++i) {
+          visitor(result.get_item(i));
+        }
+        return item_count;
+      }
+
+      // Read the result a page at a time, continuing after the last `_id`
+      // read, so that at most one page is held in memory.
+      size_t item_count = 0;
+      json after_id;
+      for (bool first_page = true;; first_page = false) {
+        const auto page = first_page
+                              ? ditto->get_store().execute(
+                                    paged_query(query, true))
+                              : ditto->get_store().execute(
+                                    paged_query(query, false),
+                                    {{"afterId", after_id}});
+        const auto page_count = page.item_count();
+        for (size_t i = 0; i < page_count; ++i) {
+          visitor(page.get_item(i));
+        }
+        item_count += page_count;
+        if (page_count < STREAMING_PAGE_SIZE) {
+          break;
+        }
+        after_id =
+            json::parse(page.get_item(page_count - 1).json_string()).at("_id");
+      }
+      log_debug("Executed DQL query in pages; count=" + to_string(item_count));
+      return item_count;
+    } catch (const exception &err) {
+      log_error("Failed to execute DQL query: " + string(err.what()));
+      throw runtime_error("unable to execute DQL query: " + string(err.what()));
+    }
+  }
+
   void insert_initial_tasks() {
     try {
       lock_guard<mutex> lock(*mtx);
@@ -384,11 +1400,16 @@ public:
            "Schedule dentist appointment"},
           {"38411F1B-6B49-4346-90C3-0B16CE97E174", "Pay bills"}};
 
+      // The initial tasks are given the oldest possible creation and
+      // modification times, so that they never appear newer than tasks that
+      // users have changed.
       for (const auto &task : initial_tasks) {
         const json task_args = {{"_id", task._id},
                                 {"title", task.title},
                                 {"done", task.done},
-                                {"deleted", task.deleted}};
+                                {"deleted", task.deleted},
+                                {"created_at", 0},
+                                {"modified_at", 0}};
         const auto command = "INSERT INTO tasks INITIAL DOCUMENTS (:newTask)";
         ditto->get_store().execute(command, {{"newTask", task_args}});
       }
@@ -406,14 +1427,16 @@ TasksPeer::TasksPeer(
   string websocket_url,
   string auth_url,
   bool enable_cloud_sync, 
-  string persistence_dir)
+  string persistence_dir,
+  TransportOptions transport_options)
     : impl(new Impl(
       std::move(app_id), 
       std::move(online_playground_token),
       std::move(websocket_url),
       std::move(auth_url),
       enable_cloud_sync, 
-      std::move(persistence_dir))) {}
+      std::move(persistence_dir),
+      transport_options)) {}
 
 TasksPeer::~TasksPeer() noexcept {
   try {
@@ -436,6 +1459,11 @@ vector<Task> TasksPeer::get_tasks(bool include_deleted_tasks) {
   return impl->get_tasks(include_deleted_tasks);
 }
 
+vector<Task> TasksPeer::get_tasks_modified_since(int64_t since, size_t limit,
+                                                 const string &after_id) {
+  return impl->get_tasks_modified_since(since, limit, after_id);
+}
+
 Task TasksPeer::get_task(const string &task_id) {
   return impl->get_task(task_id);
 }
@@ -450,25 +1478,124 @@ void TasksPeer::mark_task_complete(const string &task_id, bool done) {
   impl->mark_task_complete(task_id, done);
 }
 
+bool TasksPeer::toggle_task(const string &task_id) {
+  return impl->toggle_task(task_id);
+}
+
+optional<Task> TasksPeer::update_task_if(const Task &expected,
+                                         const Task &desired) {
+  return impl->update_task_if(expected, desired);
+}
+
+Task TasksPeer::upsert_task(const Task &task) {
+  return impl->upsert_task(task);
+}
+
 void TasksPeer::update_task_title(const string &task_id, const string &title) {
   impl->update_task_title(task_id, title);
 }
 
+uint64_t TasksPeer::attach_task_body(const string &task_id,
+                                    const string &path) {
+  return impl->attach_task_body(task_id, path);
+}
+
+shared_ptr<ditto::AttachmentFetcher>
+TasksPeer::fetch_task_body(const string &task_id,
+                           TaskBodyFetchHandlers handlers) {
+  return impl->fetch_task_body(task_id, std::move(handlers));
+}
+
 void TasksPeer::delete_task(const string &task_id) {
   impl->delete_task(task_id);
 }
 
 void TasksPeer::evict_deleted_tasks() { impl->evict_deleted_tasks(); }
 
+void TasksPeer::set_retention_policy(const RetentionPolicy &policy) {
+  impl->set_retention_policy(policy);
+}
+
+RetentionStats TasksPeer::retention_stats() const {
+  return impl->retention_stats();
+}
+
+void TasksPeer::start_counting() { impl->start_counting(); }
+
+void TasksPeer::stop_counting() { impl->stop_counting(); }
+
+TaskStats TasksPeer::stats() const { return impl->stats(); }
+
+TaskStats TasksPeer::count_tasks() const { return impl->count_tasks(); }
+
+StorageReport TasksPeer::storage_report(size_t sample_size) {
+  return impl->storage_report(sample_size);
+}
+
+void TasksPeer::set_write_behind(chrono::milliseconds window,
+                                 size_t max_pending) {
+  impl->set_write_behind(window, max_pending);
+}
+
+void TasksPeer::flush_writes() { impl->flush_writes(); }
+
+WriteBufferStats TasksPeer::write_behind_stats() const {
+  return impl->write_behind_stats();
+}
+
 shared_ptr<ditto::StoreObserver> TasksPeer::register_tasks_observer(
     function<void(const std::vector<Task> &)> callback) {
-  return impl->register_tasks_observer(callback);
+  return impl->observe(TaskFilter{}, TaskSort::Id, 0, std::move(callback));
+}
+
+shared_ptr<ditto::StoreObserver>
+TasksPeer::observe(const TaskFilter &filter, TaskSort sort, size_t limit,
+                   function<void(const std::vector<Task> &)> callback) {
+  return impl->observe(filter, sort, limit, std::move(callback));
 }
 
 string TasksPeer::execute_dql_query(const string &query) {
   return impl->execute_dql_query(query);
 }
 
+size_t TasksPeer::execute_dql_query_streaming(
+    const string &query,
+    const function<void(const ditto::QueryResultItem &)> &visitor) {
+  return impl->execute_dql_query_streaming(query, visitor);
+}
+
+void TasksPeer::create_indexes() { impl->create_indexes(); }
+
+string TasksPeer::explain_query(const string &query) {
+  return impl->explain_query(query);
+}
+
+const vector<string> &TasksPeer::get_index_statements() {
+  return index_statements;
+}
+
+void TasksPeer::set_subscriptions(vector<string> queries,
+                                  optional<chrono::seconds> recent) {
+  impl->set_subscriptions(std::move(queries), recent);
+}
+
+vector<string> TasksPeer::get_subscriptions() const {
+  return impl->get_subscriptions();
+}
+
+string TasksPeer::subscription_query_all() { return "SELECT * FROM tasks"; }
+
+string TasksPeer::subscription_query_active() {
+  return "SELECT * FROM tasks WHERE NOT deleted";
+}
+
+string TasksPeer::subscription_query_modified_within(chrono::seconds age) {
+  const auto cutoff =
+      task_timestamp_now() -
+      chrono::duration_cast<chrono::milliseconds>(age).count();
+  return "SELECT * FROM tasks WHERE modified_at >= " + to_string(cutoff);
+}
+
 string TasksPeer::get_ditto_sdk_version() {
   return ditto::Ditto::get_sdk_version();
 }
@@ -1,12 +1,84 @@
 #ifndef DITTO_QUICKSTART_TASKS_PEER_H
 #define DITTO_QUICKSTART_TASKS_PEER_H
 
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
+#include "retention.h"
+#include "storage_report.h"
 #include "task.h"
+#include "transport_options.h"
+#include "write_buffer.h"
+
+/// Criteria for selecting the tasks delivered by `TasksPeer::observe()`.
+///
+/// A task is selected only if it matches every criterion that is set.
+struct TaskFilter {
+  /// Select only the task with this ID.
+  std::optional<std::string> id;
+
+  /// Select only tasks with this completion status.
+  std::optional<bool> done;
+
+  /// Select only tasks whose title contains this string (case-sensitive).
+  std::optional<std::string> title_contains;
+
+  /// Also select tasks that have been deleted but are still in the local
+  /// store.
+  bool include_deleted = false;
+};
+
+/// Order of the tasks delivered by `TasksPeer::observe()`.
+enum class TaskSort {
+  Id,              ///< by ID, as returned by `TasksPeer::get_tasks()`
+  Title,           ///< by title, and then by ID
+  RecentlyModified ///< most recently modified first
+};
+
+/// Counts of the tasks in the local store, returned by `TasksPeer::stats()`.
+struct TaskStats {
+  /// Number of tasks that are neither done nor deleted.
+  std::size_t open = 0;
+
+  /// Number of tasks that are done but not deleted.
+  std::size_t done = 0;
+
+  /// Number of deleted tasks (tombstones) that are still in the local store.
+  std::size_t deleted = 0;
+
+  /// Return the number of documents in the tasks collection.
+  std::size_t total() const { return open + done + deleted; }
+
+  /// Return the fraction of the documents in the tasks collection that are
+  /// tombstones, or 0 if there are none.
+  double tombstone_ratio() const {
+    const auto count = total();
+    return count > 0 ? static_cast<double>(deleted) / count : 0.0;
+  }
+};
+
+/// Functions called as `TasksPeer::fetch_task_body()` progresses.
+///
+/// They are called on a thread owned by Ditto, so they should return
+/// promptly, and must not call methods of the TasksPeer.  Any of them may be
+/// empty.
+struct TaskBodyFetchHandlers {
+  /// Called as the body is received, with the number of bytes received so far
+  /// and the body's total size.
+  std::function<void(std::uint64_t fetched_bytes, std::uint64_t total_bytes)>
+      on_progress;
+
+  /// Called once, when the whole body is in the local store.
+  std::function<void(const ditto::Attachment &body)> on_complete;
+
+  /// Called if the body is deleted before it can be fetched.
+  std::function<void()> on_deleted;
+};
 
 /// An agent that can create, read, update, and delete tasks, and sync them with
 /// other devices.
@@ -15,14 +87,41 @@ public:
   /// Returns a string identifying the version of the Ditto SDK.
   static std::string get_ditto_sdk_version();
 
+  /// Returns the DQL statements that create the indexes on the tasks
+  /// collection that the peer's queries rely on.
+  static const std::vector<std::string> &get_index_statements();
+
+  /// Returns a sync subscription query for all tasks, including deleted ones.
+  /// This is the default.
+  static std::string subscription_query_all();
+
+  /// Returns a sync subscription query for tasks that are not deleted.
+  ///
+  /// Note that a task deleted on another peer no longer matches this query,
+  /// so the deletion itself is not synced.  Combine it with
+  /// `subscription_query_modified_within()` to receive recent deletions.
+  static std::string subscription_query_active();
+
+  /// Returns a sync subscription query for tasks modified within the given
+  /// time before now.
+  ///
+  /// The cutoff time is fixed when this is called.  To subscribe to a window
+  /// that moves forward, pass its age to `set_subscriptions()` instead.
+  static std::string subscription_query_modified_within(
+      std::chrono::seconds age);
+
   /// Construct a new TasksPeer object.
+  ///
+  /// `transport_options` selects the transports used to sync; by default, all
+  /// peer-to-peer transports and the WebSocket URL are used.
   TasksPeer(
     std::string ditto_app_id, 
     std::string ditto_online_playground_token, 
     std::string ditto_websocket_url,
     std::string ditto_auth_url,
     bool enable_cloud_sync, 
-    std::string ditto_persistence_dir);
+    std::string ditto_persistence_dir,
+    TransportOptions transport_options = {});
 
   virtual ~TasksPeer() noexcept;
 
@@ -36,11 +135,31 @@ public:
   void start_sync();
 
   /// Stop the peer, disabling it from syncing tasks with other devices.
+  ///
+  /// Changes held by write-behind are written first.
   void stop_sync();
 
   /// Return true if peer is currently syncing tasks with other devices.
   bool is_sync_active() const;
 
+  /// Set the DQL queries that determine which tasks are synced from other
+  /// peers.  Each query is a separate sync subscription.
+  ///
+  /// If sync is active, the new subscriptions are registered before the old
+  /// ones are cancelled, so that sync does not need to be restarted and
+  /// documents in both scopes are synced throughout.
+  ///
+  /// If `recent` is set, a subscription to tasks modified within that time is
+  /// added, and its cutoff is moved forward periodically by a background
+  /// thread, so that it covers a sliding window.  `queries` may be empty in
+  /// that case.
+  void set_subscriptions(
+      std::vector<std::string> queries,
+      std::optional<std::chrono::seconds> recent = std::nullopt);
+
+  /// Return the current sync subscription queries.
+  std::vector<std::string> get_subscriptions() const;
+
   /// Create a new task and add it to the collection.
   ///
   /// @return the _id of the new task.
@@ -55,6 +174,32 @@ public:
   /// @return all tasks in the collection, ordered by ID.
   std::vector<Task> get_tasks(bool include_deleted_tasks = false);
 
+  /// Get the tasks that have changed since a given time, including those that
+  /// have been deleted, ordered by `modified_at` and then by ID.
+  ///
+  /// This lets a consumer that mirrors the tasks collection poll for changes
+  /// with work proportional to the number of changes, rather than to the size
+  /// of the collection.  To read the next page, pass the `modified_at` and
+  /// `_id` of the last task returned as `since` and `after_id`.  To poll
+  /// again later, pass only its `modified_at`, and skip the tasks with that
+  /// time that have already been read: a task changed afterwards, but in the
+  /// same millisecond, is missed by a poll after the last ID if its ID sorts
+  /// before it.  CdcStream polls this way.
+  ///
+  /// `modified_at` is set from the clock of the peer that made the change,
+  /// so a change synced from a peer whose clock is behind can have an earlier
+  /// time than changes that have already been read.  Consumers that need
+  /// every change should poll from somewhat before the last time they read.
+  ///
+  /// @param since only tasks with `modified_at` at or after this time, in
+  /// milliseconds since the Unix epoch, are returned.
+  /// @param limit maximum number of tasks to return.
+  /// @param after_id if not empty, tasks with `modified_at` equal to `since`
+  /// are only returned if their ID sorts after this.
+  std::vector<Task> get_tasks_modified_since(std::int64_t since,
+                                             std::size_t limit = 1000,
+                                             const std::string &after_id = "");
+
   /// Find a task by its ID.
   ///
   /// @return the Task that exactly matches the specified ID
@@ -79,9 +224,69 @@ public:
   /// Mark task as completed or not completed.
   void mark_task_complete(const std::string &task_id, bool done);
 
+  /// Invert the completion status of a task.
+  ///
+  /// The task is not read first: each conditional UPDATE sets one status only
+  /// if the task has the other, so concurrent toggles are never lost, and the
+  /// result is that of this call's change rather than of a later one.  This
+  /// takes one statement for an open task and two for a done one.  A task
+  /// with no `done` property is treated as open.
+  ///
+  /// @return whether the task is done after it has been toggled
+  ///
+  /// @throws runtime_error if there is no undeleted task with the given ID.
+  bool toggle_task(const std::string &task_id);
+
+  /// Replace the properties of a task, but only if they still have the values
+  /// in `expected` (compare-and-set).
+  ///
+  /// The task to update is identified by `expected._id`; the `_id` of
+  /// `desired` is ignored.
+  ///
+  /// @return the task after the update, or an empty optional if the task's
+  /// current properties do not match `expected`.
+  std::optional<Task> update_task_if(const Task &expected, const Task &desired);
+
+  /// Insert a task, or replace the properties of the existing task that has
+  /// the same ID.
+  ///
+  /// If the task's `_id` is empty, a new ID is generated.  If its
+  /// `created_at` is 0, an existing task keeps its creation time, and a new
+  /// task is created now.
+  ///
+  /// @return the task as stored, including its ID.
+  Task upsert_task(const Task &task);
+
   /// Change the title of the specified task
   void update_task_title(const std::string &task_id, const std::string &title);
 
+  /// Attach the contents of a file to a task as its body, replacing any
+  /// previous body.
+  ///
+  /// The contents are stored as a Ditto attachment, which the task only
+  /// refers to, so that listing and observing tasks, and syncing changes to
+  /// their other properties, never involves the body.  Other peers receive
+  /// the body only when they call `fetch_task_body()`.
+  ///
+  /// @return the size of the body in bytes.
+  ///
+  /// @throws runtime_error if there is no undeleted task with the given ID,
+  /// or the file cannot be read.
+  std::uint64_t attach_task_body(const std::string &task_id,
+                                 const std::string &path);
+
+  /// Start fetching the body of a task, calling `handlers` as it progresses.
+  ///
+  /// A body that is already in the local store completes promptly.
+  /// Otherwise, it is received from other peers in chunks while sync is
+  /// active.  The returned fetcher must be kept until the fetch completes;
+  /// call its `stop()` method to cancel it.
+  ///
+  /// @throws runtime_error if there is no undeleted task with the given ID,
+  /// or the task has no body.
+  std::shared_ptr<ditto::AttachmentFetcher>
+  fetch_task_body(const std::string &task_id, TaskBodyFetchHandlers handlers);
+
   /// Delete the specified task from the collection.
   ///
   /// Note that this marks the task as deleted, and it will no longer appear in
@@ -92,6 +297,90 @@ public:
   /// Remove all deleted tasks from the local store.
   void evict_deleted_tasks();
 
+  /// Evict tasks from the local store in the background, according to the
+  /// given policy.
+  ///
+  /// This replaces any previous policy.  If no rule in the policy is enabled,
+  /// background eviction stops.  See RetentionEngine.
+  void set_retention_policy(const RetentionPolicy &policy);
+
+  /// Return statistics for the current retention policy, which are all zero
+  /// if there is none.
+  RetentionStats retention_stats() const;
+
+  /// Count the tasks and register an observer that keeps the counts returned
+  /// by `stats()` up to date, so they reflect local changes, changes synced
+  /// from other peers, and evictions.
+  ///
+  /// This queries the store and blocks until the count is done, so a UI
+  /// should call it off its own thread.  The observer reads every task each
+  /// time the collection changes, so register it only while the counts are
+  /// shown, and use `count_tasks()` to count the tasks once.  Does nothing if
+  /// counting has already started.  Failures are logged, leaving the counts
+  /// unchanged.
+  void start_counting();
+
+  /// Unregister the observer registered by `start_counting()`.  `stats()`
+  /// then returns the last counts until counting starts again.
+  void stop_counting();
+
+  /// Return the number of open, done and deleted tasks maintained by
+  /// `start_counting()`, or zeros if it has never been called.
+  ///
+  /// This only reads the cached counts, so it never waits on the store.  The
+  /// counts may lag a change by the time it takes for the observer to be
+  /// notified.
+  TaskStats stats() const;
+
+  /// Count the open, done and deleted tasks in the local store once, with
+  /// `COUNT` queries, without registering an observer.
+  TaskStats count_tasks() const;
+
+  /// Report on the storage used by the peer: the size of its persistence
+  /// directory, the number of live and deleted tasks, and the sizes of
+  /// documents and titles.
+  ///
+  /// The tasks are counted with `count_tasks()`, which decodes no documents
+  /// but whose cost still grows with the size of the store.  Document and
+  /// title sizes are measured over at most `sample_size` documents: if there
+  /// are more, over the first `sample_size` in the store's order, which is a
+  /// prefix rather than a random sample (see `StorageReport::sampled_all`).
+  /// The report's `growth` is not set; use `StorageReport::compare_with()`.
+  StorageReport storage_report(std::size_t sample_size = 10000);
+
+  /// Buffer changes made by `update_task()`, `mark_task_complete()`,
+  /// `update_task_title()` and `delete_task()`, and write them in groups on a
+  /// background thread ("write-behind").
+  ///
+  /// Changes to the same task within `window` are coalesced, so that only the
+  /// task's final state is written and synced, and each group is written by a
+  /// single statement.  A change is written at most `window` after the oldest
+  /// change in its group was made, or sooner if `max_pending` tasks have
+  /// changes waiting.  Reads by this peer, such as `get_tasks()`, include
+  /// waiting changes, but observers only see them once they are written.
+  ///
+  /// While write-behind is enabled, the methods above return before the
+  /// change is written, so an error such as a missing task is not thrown:
+  /// the change is discarded, logged, and counted in `write_behind_stats()`.
+  /// Each task is written with an `UPDATE` of only its changed properties,
+  /// so a task that has been evicted or deleted meanwhile is not recreated.
+  /// Other methods that change tasks write waiting changes first, so that
+  /// changes are applied in order.
+  ///
+  /// A `window` of zero disables write-behind, which is the default.  Changes
+  /// waiting when the setting is replaced are written first.  This must not be
+  /// called while other threads are using the peer.
+  void set_write_behind(std::chrono::milliseconds window,
+                        std::size_t max_pending = 256);
+
+  /// Write the changes held by write-behind, returning when they have been
+  /// written.  Does nothing if write-behind is disabled.
+  void flush_writes();
+
+  /// Return statistics for write-behind, which are all zero if it is
+  /// disabled.
+  WriteBufferStats write_behind_stats() const;
+
   /// Run a DQL query using the peer's Ditto instance.
   ///
   /// This function is provided for diagnostic purposes.  It should not be used
@@ -102,13 +391,65 @@ public:
   /// arrays.
   std::string execute_dql_query(const std::string &query);
 
+  /// Run a DQL query using the peer's Ditto instance, passing each result
+  /// item to `visitor` in order.
+  ///
+  /// Unlike `execute_dql_query()`, this does not build a JSON representation
+  /// of the whole result.  A query of the form `SELECT * FROM collection`,
+  /// optionally with a `WHERE` clause, is also read in pages in `_id` order,
+  /// so that it uses memory proportional to the page size rather than to the
+  /// size of the result; documents changed while it runs may or may not be
+  /// included, but none is visited twice.  Other queries, such as those that
+  /// sort, limit, group or project their results, are run as one statement,
+  /// whose result the SDK holds in memory while it is visited.  The visitor
+  /// must not call other methods of this TasksPeer.
+  ///
+  /// This function is provided for diagnostic purposes.  It should not be used
+  /// for general application functionality.
+  ///
+  /// @return the number of items visited
+  std::size_t execute_dql_query_streaming(
+      const std::string &query,
+      const std::function<void(const ditto::QueryResultItem &)> &visitor);
+
+  /// Create the indexes returned by `get_index_statements()`, if they do not
+  /// already exist.
+  ///
+  /// This is done when the peer is constructed, so it only needs to be called
+  /// again if indexes have been dropped.  Failures are logged, not thrown.
+  void create_indexes();
+
+  /// Return the query plan for a DQL query, as indented JSON.
+  ///
+  /// This function is provided for diagnostic purposes.
+  std::string explain_query(const std::string &query);
+
   /// Subscribe to updates to the tasks collection.
   ///
+  /// This is equivalent to `observe()` with the default filter and sort
+  /// order, and no limit.
+  ///
   /// @returns a subscriber object that, when destroyed, will cancel the
   /// subscription.
   std::shared_ptr<ditto::StoreObserver> register_tasks_observer(
       std::function<void(const std::vector<Task> &)> callback);
 
+  /// Subscribe to updates to the tasks that match a filter.
+  ///
+  /// The filter, sort order and limit are evaluated by the store as part of a
+  /// live query, so the callback receives only the selected tasks, and only
+  /// those are decoded each time the result changes.  Views that show a
+  /// subset of the tasks, such as only open tasks or a single task being
+  /// edited, should use this rather than filtering the full list.
+  ///
+  /// @param limit maximum number of tasks delivered, or 0 for no limit.
+  ///
+  /// @returns a subscriber object that, when destroyed, will cancel the
+  /// subscription.
+  std::shared_ptr<ditto::StoreObserver>
+  observe(const TaskFilter &filter, TaskSort sort, std::size_t limit,
+          std::function<void(const std::vector<Task> &)> callback);
+
   /// Add a set of initial documents to the tasks collection.
   void insert_initial_tasks();
 
@@ -3,9 +3,20 @@
 #include "tasks_tui.h"
 #include "env.h"
 #include "tasks_log.h"
+#include "work_queue.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 
 #include <unistd.h>
 
@@ -14,19 +25,95 @@
 #include "ftxui/component/screen_interactive.hpp"
 #include "ftxui/dom/elements.hpp"
 
+// A completed operation that has not yet been reflected in a snapshot is retired
+// anyway after this interval, plus the write-behind window, so that a
+// conflicting remote change cannot leave it stuck.  With write-behind, a
+// command completes before its change is written, and the change is written
+// within the window, so the operation is kept until then.
+static constexpr std::chrono::seconds PENDING_OP_STALE_TIMEOUT{1};
+
+// At most this much of a task's body is shown when it is opened.
+static constexpr std::size_t BODY_PREVIEW_BYTES = 64 * 1024;
+
 class TasksTui::Impl {
 private:
+  using Clock = std::chrono::steady_clock;
+
+  // A local modification that has been submitted to the command queue, but
+  // whose effect has not yet been seen in a snapshot delivered by the tasks
+  // observer.
+  struct PendingOp {
+    enum class Kind { Add, Toggle, Title, Delete } kind;
+    std::uint64_t seq;
+    std::string task_id; // for Add, empty until the command completes
+    std::string title;   // Add and Title
+    bool done = false;   // Toggle
+    bool completed = false;
+    Clock::time_point submitted;
+    Clock::time_point completed_at;
+  };
+
+  // Summary of elapsed times between handling an input event and rendering the
+  // resulting frame.
+  struct LatencyStats {
+    Clock::duration last{};
+    Clock::duration max{};
+    std::uint64_t count = 0;
+
+    void record(Clock::duration d) {
+      last = d;
+      max = std::max(max, d);
+      ++count;
+    }
+  };
+
   TasksPeer &peer;
-  std::vector<Task> tasks;
+  const TasksTuiOptions options;
+  const Clock::duration pending_op_stale_timeout;
+
+  // Snapshots delivered by the tasks observer are handed to the UI thread
+  // through this single slot.  A snapshot that is replaced before it has been
+  // applied is dropped and counted in skipped_snapshots.  All members in this
+  // group other than skipped_snapshots are guarded by snapshot_mtx.
+  std::mutex snapshot_mtx;
+  std::condition_variable snapshot_cv;
+  std::vector<Task> pending_snapshot;
+  bool has_pending_snapshot = false;
+  bool apply_posted = false;
+  bool pacer_stopping = false;
+  Clock::time_point next_apply_allowed;
+  std::atomic<std::uint64_t> skipped_snapshots{0};
+
+  std::vector<Task> store_tasks; // most recent snapshot from the observer
+  std::vector<Task> tasks;       // store_tasks with pending ops applied
+  std::vector<PendingOp> pending_ops;
+  std::uint64_t next_op_seq = 1;
+  bool sync_toggle_pending = false;
+  Clock::time_point input_time;
+  bool input_awaiting_render = false;
+  LatencyStats input_latency;
   ftxui::Component tasks_list;
   ftxui::ScreenInteractive screen;
   std::string status_text;
 
+  // State of the task body being viewed, if any.  body_view_seq identifies
+  // the most recent fetch, so that events from earlier ones are ignored.
+  std::shared_ptr<ditto::AttachmentFetcher> body_fetcher;
+  std::uint64_t body_view_seq = 0;
+  std::string body_view_title;
+  std::string body_view_status;
+  std::string body_view_text;
+
+  // Peer operations run here so that the UI thread never waits on Ditto.  This
+  // must be declared last so that it is drained and joined before the other
+  // members are destroyed.
+  WorkQueue commands;
+
   // Return a pointer to the task that is currently active in the task list, or
   // nullptr if none.
   //
   // The returned pointer is only valid until the next call to
-  // update_tasks_list().
+  // set_tasks_list().
   const Task *active_task() const {
     for (size_t i = 0; i < std::min(tasks.size(), tasks_list->ChildCount());
          i++) {
@@ -50,7 +137,7 @@ private:
   }
 
   // Set the contents of the task list to the given tasks.
-  void update_tasks_list(std::vector<Task> new_tasks) {
+  void set_tasks_list(std::vector<Task> new_tasks) {
     if (new_tasks == tasks) {
       return;
     }
@@ -64,18 +151,15 @@ private:
 
     ftxui::Component active_checkbox;
     for (auto &task : tasks) {
-      auto checkbox =
-          ftxui::Checkbox(task.title, &task.done,
-                          ftxui::CheckboxOption{.on_change = [this, &task] {
-                            try {
-                              peer.mark_task_complete(task._id, task.done);
-                            } catch (const std::exception &err) {
-                              log_error("Failed to mark task complete: " +
-                                        std::string(err.what()));
-                            }
-                          }});
+      auto checkbox = ftxui::Checkbox(
+          task.body_size > 0 ? task.title + " 📎" : task.title, &task.done,
+          ftxui::CheckboxOption{.on_change = [this, &task] {
+            if (!task._id.empty()) {
+              submit_toggle(task._id, task.done);
+            }
+          }});
       tasks_list->Add(checkbox);
-      if (task._id == active_task_id()) {
+      if (!task_id.empty() && task._id == task_id) {
         active_checkbox = checkbox;
       }
     }
@@ -87,17 +171,434 @@ private:
     screen.RequestAnimationFrame();
   }
 
-  // Toggle sync on/off
-  void toggle_sync() {
-    try {
-      if (peer.is_sync_active()) {
-        peer.stop_sync();
-      } else {
-        peer.start_sync();
+  // Return true if the effect of the operation is visible in store_tasks.
+  bool is_reflected_in_store(const PendingOp &op) const {
+    auto it = std::find_if(
+        store_tasks.cbegin(), store_tasks.cend(),
+        [&op](const Task &task) { return task._id == op.task_id; });
+    switch (op.kind) {
+    case PendingOp::Kind::Add:
+      return it != store_tasks.cend();
+    case PendingOp::Kind::Toggle:
+      return it == store_tasks.cend() || it->done == op.done;
+    case PendingOp::Kind::Title:
+      return it == store_tasks.cend() || it->title == op.title;
+    case PendingOp::Kind::Delete:
+      return it == store_tasks.cend();
+    }
+    return true;
+  }
+
+  // Drop completed operations whose effects are now visible in store_tasks.
+  void retire_completed_ops() {
+    const auto now = Clock::now();
+    pending_ops.erase(
+        std::remove_if(pending_ops.begin(), pending_ops.end(),
+                       [this, now](const PendingOp &op) {
+                         return op.completed &&
+                                (is_reflected_in_store(op) ||
+                                 now - op.completed_at >
+                                     pending_op_stale_timeout);
+                       }),
+        pending_ops.end());
+  }
+
+  // Rebuild the displayed task list from the latest store snapshot plus all
+  // pending local modifications.
+  void refresh_tasks_list() {
+    auto displayed = store_tasks;
+    for (const auto &op : pending_ops) {
+      auto it = std::find_if(
+          displayed.begin(), displayed.end(),
+          [&op](const Task &task) { return task._id == op.task_id; });
+      switch (op.kind) {
+      case PendingOp::Kind::Add:
+        if (it == displayed.end() || op.task_id.empty()) {
+          displayed.emplace_back(op.task_id, op.title);
+        }
+        break;
+      case PendingOp::Kind::Toggle:
+        if (it != displayed.end()) {
+          it->done = op.done;
+        }
+        break;
+      case PendingOp::Kind::Title:
+        if (it != displayed.end()) {
+          it->title = op.title;
+        }
+        break;
+      case PendingOp::Kind::Delete:
+        if (it != displayed.end()) {
+          displayed.erase(it);
+        }
+        break;
+      }
+    }
+    set_tasks_list(std::move(displayed));
+  }
+
+  // Handle a new snapshot of the tasks collection.
+  void update_tasks_list(std::vector<Task> new_tasks) {
+    store_tasks = std::move(new_tasks);
+    retire_completed_ops();
+    refresh_tasks_list();
+  }
+
+  // Called on the observer's thread with each new snapshot of the tasks
+  // collection.
+  void offer_snapshot(const std::vector<Task> &new_tasks) {
+    {
+      std::lock_guard<std::mutex> lock(snapshot_mtx);
+      if (has_pending_snapshot) {
+        ++skipped_snapshots;
+      }
+      pending_snapshot = new_tasks;
+      has_pending_snapshot = true;
+    }
+    snapshot_cv.notify_all();
+  }
+
+  // Body of the frame pacer thread, which posts at most one snapshot
+  // application to the UI thread at a time, no sooner than allowed by the
+  // maximum refresh rate and frame budget.
+  void pace_snapshots() {
+    std::unique_lock<std::mutex> lock(snapshot_mtx);
+    for (;;) {
+      snapshot_cv.wait(lock, [this] {
+        return pacer_stopping || (has_pending_snapshot && !apply_posted);
+      });
+      if (pacer_stopping) {
+        return;
+      }
+      if (snapshot_cv.wait_until(lock, next_apply_allowed,
+                                 [this] { return pacer_stopping; })) {
+        return;
+      }
+      apply_posted = true;
+      screen.Post([this] { apply_pending_snapshot(); });
+    }
+  }
+
+  // Called on the UI thread to apply the most recently offered snapshot.
+  void apply_pending_snapshot() {
+    std::vector<Task> snapshot;
+    {
+      std::lock_guard<std::mutex> lock(snapshot_mtx);
+      snapshot.swap(pending_snapshot);
+      has_pending_snapshot = false;
+    }
+
+    const auto start = Clock::now();
+    update_tasks_list(std::move(snapshot));
+    const auto finish = Clock::now();
+
+    const auto elapsed = finish - start;
+    auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::seconds(1)) / std::max(options.max_refresh_hz, 1U);
+    if (elapsed > options.frame_budget) {
+      interval += elapsed - options.frame_budget;
+      log_debug("Applying tasks snapshot exceeded frame budget by " +
+                std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(
+                                   elapsed - options.frame_budget)
+                                   .count()) +
+                "us");
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(snapshot_mtx);
+      apply_posted = false;
+      next_apply_allowed = start + interval;
+    }
+    snapshot_cv.notify_all();
+  }
+
+  // Number of submitted operations that have not yet completed.
+  std::size_t pending_op_count() const {
+    return std::count_if(pending_ops.cbegin(), pending_ops.cend(),
+                         [](const PendingOp &op) { return !op.completed; }) +
+           (sync_toggle_pending ? 1 : 0);
+  }
+
+  // Called on the UI thread when the command for the specified operation has
+  // finished.  If it failed, error_message is non-empty.
+  void complete_op(std::uint64_t seq, const std::string &task_id,
+                   const std::string &error_message) {
+    auto it = std::find_if(
+        pending_ops.begin(), pending_ops.end(),
+        [seq](const PendingOp &op) { return op.seq == seq; });
+    if (it == pending_ops.end()) {
+      return;
+    }
+
+    const auto now = Clock::now();
+    log_debug("TUI command " + std::to_string(seq) + " completed in " +
+              std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(
+                                 now - it->submitted)
+                                 .count()) +
+              "us");
+
+    if (error_message.empty()) {
+      it->completed = true;
+      it->completed_at = now;
+      if (it->task_id.empty()) {
+        it->task_id = task_id;
+      }
+    } else {
+      status_text = "⚠ " + error_message;
+      pending_ops.erase(it);
+    }
+    retire_completed_ops();
+    refresh_tasks_list();
+
+    // force redraw of status indicator
+    screen.RequestAnimationFrame();
+  }
+
+  // Apply an operation to the displayed list immediately, then run the
+  // corresponding peer command on the command queue.
+  //
+  // The command returns the ID of the affected task.
+  void submit(PendingOp op, std::function<std::string()> command,
+              std::string failure_description) {
+    op.seq = next_op_seq++;
+    op.submitted = Clock::now();
+    const auto seq = op.seq;
+    pending_ops.push_back(std::move(op));
+    refresh_tasks_list();
+
+    commands.post([this, seq, command = std::move(command),
+                   failure_description = std::move(failure_description)] {
+      std::string task_id;
+      std::string error_message;
+      try {
+        task_id = command();
+      } catch (const std::exception &err) {
+        log_error(failure_description + ": " + std::string(err.what()));
+        error_message = failure_description;
+      }
+      screen.Post([this, seq, task_id, error_message] {
+        complete_op(seq, task_id, error_message);
+      });
+    });
+  }
+
+  void submit_add(const std::string &title) {
+    PendingOp op{PendingOp::Kind::Add};
+    op.title = title;
+    submit(std::move(op),
+           [this, title] { return peer.add_task(title, false); },
+           "Failed to add task");
+  }
+
+  void submit_toggle(const std::string &task_id, bool done) {
+    PendingOp op{PendingOp::Kind::Toggle};
+    op.task_id = task_id;
+    op.done = done;
+    submit(std::move(op),
+           [this, task_id, done] {
+             peer.mark_task_complete(task_id, done);
+             return task_id;
+           },
+           "Failed to mark task complete");
+  }
+
+  void submit_title(const std::string &task_id, const std::string &title) {
+    PendingOp op{PendingOp::Kind::Title};
+    op.task_id = task_id;
+    op.title = title;
+    submit(std::move(op),
+           [this, task_id, title] {
+             peer.update_task_title(task_id, title);
+             return task_id;
+           },
+           "Failed to update task title");
+  }
+
+  void submit_delete(const std::string &task_id) {
+    PendingOp op{PendingOp::Kind::Delete};
+    op.task_id = task_id;
+    submit(std::move(op),
+           [this, task_id] {
+             peer.delete_task(task_id);
+             return task_id;
+           },
+           "Failed to delete task");
+  }
+
+  // Attach the contents of a file to a task as its body.
+  void submit_attach(const std::string &task_id, const std::string &path) {
+    status_text = "Attaching " + path + "...";
+    commands.post([this, task_id, path] {
+      std::string message;
+      try {
+        const auto size = peer.attach_task_body(task_id, path);
+        message = "Attached " + std::to_string(size) + " bytes";
+      } catch (const std::exception &err) {
+        log_error("Failed to attach task body: " + std::string(err.what()));
+        message = "⚠ Failed to attach " + path;
+      }
+      screen.Post([this, message] {
+        status_text = message;
+        screen.RequestAnimationFrame();
+      });
+    });
+  }
+
+  // Start fetching the body of a task for viewing.  Progress and the result
+  // are shown in the body view.
+  void open_body(const Task &task) {
+    stop_body_fetch();
+    const auto seq = ++body_view_seq;
+    body_view_title = task.title;
+    body_view_text.clear();
+    body_view_status = "Fetching " + std::to_string(task.body_size) +
+                       " bytes...";
+
+    // Handlers are called on a Ditto thread, and hand their results to the UI
+    // thread.
+    TaskBodyFetchHandlers handlers;
+    handlers.on_progress = [this, seq](std::uint64_t fetched_bytes,
+                                       std::uint64_t total_bytes) {
+      screen.Post([this, seq, fetched_bytes, total_bytes] {
+        if (seq == body_view_seq) {
+          body_view_status = "Fetched " + std::to_string(fetched_bytes) +
+                             " of " + std::to_string(total_bytes) + " bytes";
+          screen.RequestAnimationFrame();
+        }
+      });
+    };
+    handlers.on_complete = [this, seq](const ditto::Attachment &body) {
+      auto text = read_body_preview(body);
+      const auto truncated = body.len() > text.size();
+      screen.Post([this, seq, text = std::move(text), truncated] {
+        if (seq == body_view_seq) {
+          body_view_text = text;
+          body_view_status =
+              truncated ? "Showing the first " +
+                              std::to_string(BODY_PREVIEW_BYTES / 1024) + " KiB"
+                        : "";
+          screen.RequestAnimationFrame();
+        }
+      });
+    };
+    handlers.on_deleted = [this, seq] {
+      screen.Post([this, seq] {
+        if (seq == body_view_seq) {
+          body_view_status = "⚠ The body has been deleted";
+          screen.RequestAnimationFrame();
+        }
+      });
+    };
+
+    commands.post([this, seq, task_id = task._id,
+                   handlers = std::move(handlers)]() mutable {
+      try {
+        auto fetcher = peer.fetch_task_body(task_id, std::move(handlers));
+        screen.Post([this, seq, fetcher] {
+          if (seq == body_view_seq) {
+            body_fetcher = fetcher;
+          } else {
+            fetcher->stop();
+          }
+        });
+      } catch (const std::exception &err) {
+        log_error("Failed to fetch task body: " + std::string(err.what()));
+        screen.Post([this, seq] {
+          if (seq == body_view_seq) {
+            body_view_status = "⚠ Failed to fetch the body";
+            screen.RequestAnimationFrame();
+          }
+        });
       }
+    });
+  }
+
+  // Stop the current body fetch, if any, and ignore its later events.
+  void stop_body_fetch() {
+    ++body_view_seq;
+    if (body_fetcher) {
+      body_fetcher->stop();
+      body_fetcher.reset();
+    }
+  }
+
+  // Return up to BODY_PREVIEW_BYTES of a fetched body, read through a
+  // temporary file so that a large body is never held in memory.
+  static std::string read_body_preview(const ditto::Attachment &body) {
+    const auto temp_path = std::filesystem::temp_directory_path() /
+                           ("taskscpp_body_" + body.id());
+    std::string text;
+    try {
+      body.copy_to_path(temp_path.string());
+      std::ifstream in(temp_path, std::ios::binary);
+      text.resize(BODY_PREVIEW_BYTES);
+      in.read(&text[0], static_cast<std::streamsize>(text.size()));
+      text.resize(static_cast<std::size_t>(in.gcount()));
     } catch (const std::exception &err) {
-      log_error("Failed to toggle sync: " + std::string(err.what()));
+      log_error("Failed to read task body: " + std::string(err.what()));
     }
+    std::error_code ec;
+    std::filesystem::remove(temp_path, ec);
+    return text;
+  }
+
+  // Text for the status area of the bottom bar.
+  std::string status_bar_text() const {
+    std::ostringstream oss;
+    const auto pending = pending_op_count();
+    if (pending > 0) {
+      oss << "⏳ " << pending << " pending ";
+    }
+    if (input_latency.count > 0) {
+      using std::chrono::duration;
+      using std::chrono::duration_cast;
+      using ms = duration<double, std::milli>;
+      oss.precision(1);
+      oss << std::fixed << "input→render "
+          << duration_cast<ms>(input_latency.last).count() << "ms (max "
+          << duration_cast<ms>(input_latency.max).count() << "ms) ";
+    }
+    const auto skipped = skipped_snapshots.load();
+    if (skipped > 0) {
+      oss << "skipped " << skipped << " ";
+    }
+    const auto discarded = peer.write_behind_stats().tasks_discarded();
+    if (discarded > 0) {
+      oss << "⚠ " << discarded << " unwritten ";
+    }
+    const auto stats = peer.stats();
+    oss << stats.open << " open, " << stats.done << " done";
+    if (stats.deleted > 0) {
+      oss << ", " << stats.deleted << " deleted ("
+          << static_cast<int>(stats.tombstone_ratio() * 100 + 0.5) << "%)";
+    }
+    oss << " " << status_text;
+    return oss.str();
+  }
+
+  // Toggle sync on/off
+  void toggle_sync() {
+    if (sync_toggle_pending) {
+      return;
+    }
+    sync_toggle_pending = true;
+    commands.post([this] {
+      try {
+        if (peer.is_sync_active()) {
+          peer.stop_sync();
+        } else {
+          peer.start_sync();
+        }
+      } catch (const std::exception &err) {
+        log_error("Failed to toggle sync: " + std::string(err.what()));
+      }
+      screen.Post([this] {
+        sync_toggle_pending = false;
+
+        // force redraw
+        screen.RequestAnimationFrame();
+      });
+    });
 
     // force redraw
     screen.RequestAnimationFrame();
@@ -107,7 +608,7 @@ private:
   void display_ui() {
     using namespace ftxui;
 
-    enum class Mode { Normal, Create, Edit } mode = Mode::Normal;
+    enum class Mode { Normal, Create, Edit, Attach, View } mode = Mode::Normal;
 
     // Main screen layout with list of tasks and sync on/off
     auto top_bar = Renderer([this] {
@@ -123,12 +624,17 @@ private:
       });
     });
     auto bottom_bar = Renderer([this] {
-      return hbox({text("(j↑) (k↓) (Space/Enter: toggle)"
-                        " (c: create) (d: delete) (e: edit) (q: quit)") |
+      return hbox({text("(j↑) (k↓) (Space/Enter: toggle) (c: create)"
+                        " (d: delete) (e: edit) (a: attach) (o: open)"
+                        " (q: quit)") |
                        flex,
-                   text(status_text)});
+                   text(status_bar_text())});
     });
     auto main_ui = Renderer(tasks_list, [this, &top_bar, &bottom_bar] {
+      if (input_awaiting_render) {
+        input_awaiting_render = false;
+        input_latency.record(Clock::now() - input_time);
+      }
       return vbox({top_bar->Render(),                                       //
                    separator(),                                             //
                    tasks_list->Render() | vscroll_indicator | frame | flex, //
@@ -143,8 +649,28 @@ private:
     std::string modal_task_id;
     auto modal_input = Input(&modal_text, "Enter task title");
     auto modal_dialog = Renderer(modal_input, [this, &mode, &modal_input] {
+      if (mode == Mode::View) {
+        Elements lines;
+        std::istringstream body(body_view_text);
+        for (std::string line; std::getline(body, line);) {
+          lines.push_back(paragraph(line));
+        }
+        return vbox({
+                   text(body_view_title) | bold,
+                   separator(),
+                   vbox(std::move(lines)) | vscroll_indicator | frame | flex,
+                   separator(),
+                   hbox({text("(Esc: back)") | flex,
+                         text(body_view_status)}),
+               }) |
+               size(WIDTH, EQUAL, screen.dimx() - 6) |
+               size(HEIGHT, EQUAL, screen.dimy() - 4) | border;
+      }
+      const auto *title = mode == Mode::Create   ? "New Task"
+                          : mode == Mode::Attach ? "Attach File (enter path)"
+                                                 : "Edit Task";
       return vbox({
-                 text(mode == Mode::Create ? "New Task" : "Edit Task") | bold,
+                 text(title) | bold,
                  separator(),
                  modal_input->Render(),
                  filler(),
@@ -159,6 +685,12 @@ private:
     auto event_handler = CatchEvent(main_ui, [this, &mode, &show_modal,
                                               &modal_text,
                                               &modal_task_id](Event event) {
+      if (!event.is_mouse() && event != Event::Custom &&
+          !input_awaiting_render) {
+        input_time = Clock::now();
+        input_awaiting_render = true;
+      }
+
       switch (mode) {
       case Mode::Normal:
         if (event == Event::Character('c')) {
@@ -169,11 +701,7 @@ private:
         } else if (event == Event::Character('d')) {
           auto task_id = active_task_id();
           if (!task_id.empty()) {
-            try {
-              peer.delete_task(task_id);
-            } catch (const std::exception &err) {
-              log_error("Failed to delete task: " + std::string(err.what()));
-            }
+            submit_delete(task_id);
           }
         } else if (event == Event::Character('e')) {
           auto task = active_task();
@@ -184,6 +712,23 @@ private:
             show_modal = true;
             return true;
           }
+        } else if (event == Event::Character('a')) {
+          auto task = active_task();
+          if (task != nullptr && !task->_id.empty()) {
+            mode = Mode::Attach;
+            modal_task_id = task->_id;
+            modal_text = "";
+            show_modal = true;
+            return true;
+          }
+        } else if (event == Event::Character('o')) {
+          auto task = active_task();
+          if (task != nullptr && task->body_size > 0) {
+            mode = Mode::View;
+            open_body(*task);
+            show_modal = true;
+            return true;
+          }
         } else if (event == Event::Character('s')) {
           toggle_sync();
         } else if (event == Event::Character('q')) {
@@ -201,16 +746,36 @@ private:
           if (!modal_text.empty()) {
             show_modal = false;
             mode = Mode::Normal;
-            try {
-              peer.add_task(modal_text, false);
-            } catch (const std::exception &err) {
-              log_error("Failed to add task: " + std::string(err.what()));
-            }
+            submit_add(modal_text);
+          }
+          return true;
+        }
+        break;
+
+      case Mode::Attach:
+        if (event == Event::Escape) {
+          show_modal = false;
+          mode = Mode::Normal;
+          return true;
+        } else if (event == Event::Return) {
+          if (!modal_text.empty()) {
+            show_modal = false;
+            mode = Mode::Normal;
+            submit_attach(modal_task_id, modal_text);
           }
           return true;
         }
         break;
 
+      case Mode::View:
+        if (event == Event::Escape || event == Event::Character('q')) {
+          stop_body_fetch();
+          show_modal = false;
+          mode = Mode::Normal;
+        }
+        // The body view has no input field, so no other events are passed on.
+        return !event.is_mouse();
+
       case Mode::Edit:
         if (event == Event::Escape) {
           show_modal = false;
@@ -220,12 +785,7 @@ private:
           if (!modal_text.empty()) {
             show_modal = false;
             mode = Mode::Normal;
-            try {
-              peer.update_task_title(modal_task_id, modal_text);
-            } catch (const std::exception &err) {
-              log_error("Failed to update task title: " +
-                        std::string(err.what()));
-            }
+            submit_title(modal_task_id, modal_text);
           }
           return true;
         }
@@ -239,9 +799,17 @@ private:
   }
 
 public:
-  Impl(TasksPeer &p)
-      : peer(p), tasks_list(ftxui::Container::Vertical({})),
-        screen(ftxui::ScreenInteractive::Fullscreen()) {}
+  Impl(TasksPeer &p, TasksTuiOptions opts)
+      : peer(p), options(opts),
+        pending_op_stale_timeout(PENDING_OP_STALE_TIMEOUT + opts.write_behind),
+        tasks_list(ftxui::Container::Vertical({})),
+        screen(ftxui::ScreenInteractive::Fullscreen()) {
+    if (opts.write_behind > TasksTuiOptions::max_write_behind) {
+      throw std::invalid_argument(
+          "the TUI supports a write-behind window of at most " +
+          std::to_string(TasksTuiOptions::max_write_behind.count()) + "ms");
+    }
+  }
 
   ~Impl() = default;
 
@@ -251,17 +819,33 @@ public:
       std::freopen("/dev/null", "w", stderr);
     }
 
+    std::thread pacer([this] { pace_snapshots(); });
+
     auto observer = peer.register_tasks_observer(
         [this](const std::vector<Task> &new_tasks) {
-          screen.Post(
-              [this, new_tasks] { update_tasks_list(std::move(new_tasks)); });
+          offer_snapshot(new_tasks);
         });
 
+    // The counts in the status bar are kept up to date only while the TUI is
+    // shown, and the store is only queried from the command thread.
+    commands.post([this] { peer.start_counting(); });
+
     display_ui();
+
+    commands.post([this] { peer.stop_counting(); });
+    stop_body_fetch();
+    observer.reset();
+    {
+      std::lock_guard<std::mutex> lock(snapshot_mtx);
+      pacer_stopping = true;
+    }
+    snapshot_cv.notify_all();
+    pacer.join();
   }
 };
 
-TasksTui::TasksTui(TasksPeer &peer) : impl(std::make_shared<Impl>(peer)) {}
+TasksTui::TasksTui(TasksPeer &peer, TasksTuiOptions options)
+    : impl(std::make_shared<Impl>(peer, options)) {}
 
 TasksTui::~TasksTui() {}
 
@@ -5,12 +5,40 @@
 
 #include "tasks_peer.h"
 
+#include <chrono>
 #include <memory>
 
+/// Options controlling how the TUI responds to changes in the tasks collection.
+struct TasksTuiOptions {
+  /// Maximum number of times per second that a new snapshot of the tasks
+  /// collection is applied to the display.
+  ///
+  /// Snapshots that arrive faster than this are coalesced, and only the most
+  /// recent one is applied.
+  unsigned max_refresh_hz = 30;
+
+  /// Time that applying a snapshot is expected to take.  If applying a snapshot
+  /// takes longer, the next one is deferred by the excess so that input events
+  /// continue to be handled promptly during sync bursts.
+  std::chrono::milliseconds frame_budget{8};
+
+  /// Write-behind window set with `TasksPeer::set_write_behind()`, or zero if
+  /// write-behind is disabled.  A change is shown as pending until it has
+  /// been written, so this must not exceed `max_write_behind`.
+  std::chrono::milliseconds write_behind{0};
+
+  /// Longest write-behind window that the TUI supports.  A change that a
+  /// remote change conflicts with is shown until it is written, so a longer
+  /// window would hide remote changes for too long.
+  static constexpr std::chrono::milliseconds max_write_behind{10000};
+};
+
 /// Text-based interactive user interface for the Tasks application.
 class TasksTui {
 public:
-  TasksTui(TasksPeer &peer);
+  /// @throws std::invalid_argument if `options.write_behind` exceeds
+  /// `TasksTuiOptions::max_write_behind`.
+  TasksTui(TasksPeer &peer, TasksTuiOptions options = TasksTuiOptions());
 
   ~TasksTui();
 
@@ -0,0 +1,91 @@
+#include "transport_options.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+TransportProfile parse_transport_profile(const string &name) {
+  if (name == "default") {
+    return TransportProfile::Default;
+  } else if (name == "lan") {
+    return TransportProfile::Lan;
+  } else if (name == "tcp") {
+    return TransportProfile::Tcp;
+  } else if (name == "p2p") {
+    return TransportProfile::PeerToPeer;
+  } else if (name == "cloud") {
+    return TransportProfile::Cloud;
+  }
+  throw invalid_argument("unknown transport profile: " + name);
+}
+
+void parse_tcp_listen_address(const string &address,
+                              TransportOptions &options) {
+  const auto colon_pos = address.rfind(':');
+  if (colon_pos == string::npos || colon_pos == 0 ||
+      colon_pos + 1 == address.size()) {
+    throw invalid_argument("TCP address must be of the form HOST:PORT: " +
+                           address);
+  }
+
+  const auto port_string = address.substr(colon_pos + 1);
+  size_t parsed = 0;
+  unsigned long port = 0;
+  try {
+    port = stoul(port_string, &parsed);
+  } catch (const exception &) {
+    parsed = 0;
+  }
+  if (parsed != port_string.size() || port == 0 || port > 65535) {
+    throw invalid_argument("invalid TCP port: " + port_string);
+  }
+
+  options.tcp_listen_address = address.substr(0, colon_pos);
+  options.tcp_listen_port = static_cast<uint16_t>(port);
+}
+
+void apply_transport_options(ditto::TransportConfig &config,
+                             const TransportOptions &options,
+                             const string &websocket_url) {
+  // Start from nothing, so that each profile enables exactly what it needs.
+  config.peer_to_peer.bluetooth_le.enabled = false;
+  config.peer_to_peer.lan.enabled = false;
+  config.peer_to_peer.awdl.enabled = false;
+  config.peer_to_peer.wifi_aware.enabled = false;
+  config.connect.websocket_urls.clear();
+  config.connect.tcp_servers.clear();
+  config.listen.tcp.enabled = false;
+
+  bool use_websocket = false;
+  switch (options.profile) {
+  case TransportProfile::Default:
+    config.enable_all_peer_to_peer();
+    use_websocket = true;
+    break;
+  case TransportProfile::Lan:
+    config.peer_to_peer.lan.enabled = true;
+    break;
+  case TransportProfile::Tcp:
+    break;
+  case TransportProfile::PeerToPeer:
+    config.enable_all_peer_to_peer();
+    break;
+  case TransportProfile::Cloud:
+    use_websocket = true;
+    break;
+  }
+
+  if (use_websocket && !websocket_url.empty()) {
+    config.connect.websocket_urls.insert(websocket_url);
+  }
+
+  // Explicit TCP addresses are honored by every profile.
+  if (!options.tcp_listen_address.empty()) {
+    config.listen.tcp.enabled = true;
+    config.listen.tcp.interface_ip = options.tcp_listen_address;
+    config.listen.tcp.port = options.tcp_listen_port;
+  }
+  for (const auto &address : options.tcp_connect_addresses) {
+    config.connect.tcp_servers.insert(address);
+  }
+}
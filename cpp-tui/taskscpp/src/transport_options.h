@@ -0,0 +1,70 @@
+#ifndef DITTO_QUICKSTART_TRANSPORT_OPTIONS_H
+#define DITTO_QUICKSTART_TRANSPORT_OPTIONS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Ditto.h"
+
+/// Named sets of transports that a TasksPeer can use to sync.
+enum class TransportProfile {
+  /// All peer-to-peer transports, plus the WebSocket URL (the default).
+  Default,
+  /// LAN only: mDNS discovery and TCP on the local network.
+  Lan,
+  /// Only the TCP listen address and connect addresses in TransportOptions,
+  /// with no discovery.  Peers on the same host can sync over loopback.
+  Tcp,
+  /// All peer-to-peer transports, without the WebSocket URL.
+  PeerToPeer,
+  /// Only the WebSocket URL.
+  Cloud,
+};
+
+/// Transport configuration for a TasksPeer.
+struct TransportOptions {
+  TransportProfile profile = TransportProfile::Default;
+
+  /// If not empty, accept TCP connections from other peers on this interface
+  /// address (e.g. "127.0.0.1").  Requires a non-zero `tcp_listen_port`.
+  std::string tcp_listen_address;
+
+  /// Port for `tcp_listen_address`.
+  std::uint16_t tcp_listen_port = 0;
+
+  /// Addresses ("HOST:PORT") of peers to connect to directly over TCP.
+  std::vector<std::string> tcp_connect_addresses;
+
+  /// If true, the peer uses an offline playground identity for its app ID
+  /// instead of the online playground, so it never contacts the auth URL.
+  /// Together with the Tcp profile, this lets peers on one host sync with no
+  /// network access at all.  Such peers sync only with other peers that use
+  /// an offline identity for the same app ID, and cannot use cloud sync.
+  bool offline_identity = false;
+
+  /// License token passed to the SDK for an offline identity, if not empty.
+  /// SDK versions that require one for offline identities do not sync
+  /// without it.
+  std::string offline_license_token;
+};
+
+/// Parse a profile name: "default", "lan", "tcp", "p2p", or "cloud".
+///
+/// @throws std::invalid_argument if the name is not recognized.
+TransportProfile parse_transport_profile(const std::string &name);
+
+/// Parse a "HOST:PORT" address into `options.tcp_listen_address` and
+/// `options.tcp_listen_port`.
+///
+/// @throws std::invalid_argument if the address is not valid.
+void parse_tcp_listen_address(const std::string &address,
+                              TransportOptions &options);
+
+/// Replace the transport settings in `config` with those selected by
+/// `options`.  `websocket_url` is used by the profiles that include it.
+void apply_transport_options(ditto::TransportConfig &config,
+                             const TransportOptions &options,
+                             const std::string &websocket_url);
+
+#endif // DITTO_QUICKSTART_TRANSPORT_OPTIONS_H
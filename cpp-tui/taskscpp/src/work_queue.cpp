@@ -0,0 +1,58 @@
+#include "work_queue.h"
+#include "tasks_log.h"
+
+#include <exception>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+WorkQueue::WorkQueue() : worker([this] { run(); }) {}
+
+WorkQueue::~WorkQueue() noexcept {
+  {
+    lock_guard<mutex> lock(mtx);
+    stopping = true;
+  }
+  cv.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+void WorkQueue::post(function<void()> work) {
+  {
+    lock_guard<mutex> lock(mtx);
+    queue.push_back(std::move(work));
+  }
+  cv.notify_one();
+}
+
+size_t WorkQueue::pending() const {
+  lock_guard<mutex> lock(mtx);
+  return queue.size() + in_progress;
+}
+
+void WorkQueue::run() {
+  unique_lock<mutex> lock(mtx);
+  for (;;) {
+    cv.wait(lock, [this] { return stopping || !queue.empty(); });
+    if (queue.empty()) {
+      return; // stopping, and everything has been drained
+    }
+
+    auto work = std::move(queue.front());
+    queue.pop_front();
+    ++in_progress;
+    lock.unlock();
+    try {
+      work();
+    } catch (const exception &err) {
+      log_error("Unhandled exception in work queue: " + string(err.what()));
+    } catch (...) {
+      log_error("Unhandled exception in work queue");
+    }
+    lock.lock();
+    --in_progress;
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef DITTO_QUICKSTART_WORK_QUEUE_H
+#define DITTO_QUICKSTART_WORK_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/// A FIFO queue of work items executed in order on a single background thread.
+///
+/// Work items must not throw; any exception escaping a work item is caught and
+/// logged.  On destruction, all work items that have already been posted are
+/// executed before the background thread exits.
+class WorkQueue {
+public:
+  WorkQueue();
+
+  ~WorkQueue() noexcept;
+
+  WorkQueue(const WorkQueue &) = delete;
+  WorkQueue(WorkQueue &&) = delete;
+
+  WorkQueue &operator=(const WorkQueue &) = delete;
+  WorkQueue &operator=(WorkQueue &&) = delete;
+
+  /// Add a work item to the end of the queue.
+  ///
+  /// This never blocks waiting for other work items to complete.
+  void post(std::function<void()> work);
+
+  /// Return the number of work items that have been posted but have not yet
+  /// completed, including the one currently executing.
+  std::size_t pending() const;
+
+private:
+  void run();
+
+  mutable std::mutex mtx;
+  std::condition_variable cv;
+  std::deque<std::function<void()>> queue;
+  std::size_t in_progress = 0;
+  bool stopping = false;
+  std::thread worker; // must be declared last, as it uses the members above
+};
+
+#endif // DITTO_QUICKSTART_WORK_QUEUE_H
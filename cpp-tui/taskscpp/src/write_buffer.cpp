@@ -0,0 +1,138 @@
+#include "write_buffer.h"
+#include "tasks_log.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+using namespace std;
+
+void TaskChange::merge(const TaskChange &later) {
+  if (later.title) {
+    title = later.title;
+  }
+  if (later.done) {
+    done = later.done;
+  }
+  if (later.deleted) {
+    deleted = later.deleted;
+  }
+  modified_at = max(modified_at, later.modified_at);
+}
+
+void TaskChange::apply_to(Task &task) const {
+  if (title) {
+    task.title = *title;
+  }
+  if (done) {
+    task.done = *done;
+  }
+  if (deleted) {
+    task.deleted = *deleted;
+  }
+}
+
+WriteBuffer::WriteBuffer(chrono::milliseconds window, size_t max_pending,
+                         Writer writer)
+    : window(window), max_pending(max<size_t>(max_pending, 1)),
+      writer(std::move(writer)), worker([this] { run(); }) {}
+
+WriteBuffer::~WriteBuffer() noexcept {
+  {
+    lock_guard<mutex> lock(mtx);
+    stopping = true;
+  }
+  cv.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+  flush(); // in case changes were added while the worker was stopping
+}
+
+void WriteBuffer::add(const string &task_id, const TaskChange &change) {
+  lock_guard<mutex> lock(mtx);
+  if (pending.empty()) {
+    oldest_pending_time = chrono::steady_clock::now();
+  }
+  pending[task_id].merge(change);
+  ++totals.changes_buffered;
+  if (pending.size() == 1 || pending.size() >= max_pending) {
+    cv.notify_all();
+  }
+}
+
+bool WriteBuffer::overlay(Task &task) const {
+  lock_guard<mutex> lock(mtx);
+  bool found = false;
+  for (const auto *changes : {&in_flight, &pending}) {
+    const auto it = changes->find(task._id);
+    if (it != changes->end()) {
+      it->second.apply_to(task);
+      found = true;
+    }
+  }
+  return found;
+}
+
+void WriteBuffer::flush() {
+  unique_lock<mutex> lock(mtx);
+  flush_locked(lock);
+}
+
+WriteBufferStats WriteBuffer::stats() const {
+  lock_guard<mutex> lock(mtx);
+  return totals;
+}
+
+void WriteBuffer::run() {
+  unique_lock<mutex> lock(mtx);
+  while (!stopping) {
+    cv.wait(lock, [this] { return stopping || !pending.empty(); });
+    if (stopping) {
+      break;
+    }
+
+    // Wait for the oldest change's window to end, unless the buffer fills up
+    // or is flushed by another thread first.
+    const auto deadline = oldest_pending_time + window;
+    cv.wait_until(lock, deadline, [this] {
+      return stopping || pending.empty() || pending.size() >= max_pending;
+    });
+    flush_locked(lock);
+  }
+}
+
+void WriteBuffer::flush_locked(unique_lock<mutex> &lock) {
+  // Only one group is written at a time, so that groups reach the store in
+  // the order in which their changes were made.
+  cv.wait(lock, [this] { return !flushing; });
+  if (pending.empty()) {
+    return;
+  }
+  flushing = true;
+  in_flight.swap(pending);
+
+  // The writer runs without holding the lock, so that changes can be added
+  // and reads overlaid while it runs.  `in_flight` is not modified until it
+  // returns.
+  lock.unlock();
+  WriteOutcome outcome;
+  try {
+    outcome = writer(in_flight);
+  } catch (const exception &err) {
+    log_error("Failed to write buffered task changes: " + string(err.what()));
+    outcome = WriteOutcome{};
+    outcome.failed = in_flight.size();
+  }
+  lock.lock();
+
+  if (outcome.written > 0) {
+    totals.tasks_written += outcome.written;
+    ++totals.flushes;
+  }
+  totals.tasks_missing += outcome.missing;
+  totals.tasks_failed += outcome.failed;
+  in_flight.clear();
+  flushing = false;
+  cv.notify_all();
+}
@@ -0,0 +1,149 @@
+#ifndef DITTO_QUICKSTART_WRITE_BUFFER_H
+#define DITTO_QUICKSTART_WRITE_BUFFER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "task.h"
+
+/// Changes to the properties of one task that have not been written yet.
+///
+/// Properties that are empty are not changed.
+struct TaskChange {
+  std::optional<std::string> title;
+  std::optional<bool> done;
+  std::optional<bool> deleted;
+
+  /// Time of the most recent change, in the form returned by
+  /// `task_timestamp_now()`.
+  std::int64_t modified_at = 0;
+
+  /// Combine a later change into this one, so that the result has the same
+  /// effect as applying both in order.
+  void merge(const TaskChange &later);
+
+  /// Set the changed properties of a task.
+  void apply_to(Task &task) const;
+};
+
+/// Pending changes, keyed by task ID.
+using TaskChanges = std::unordered_map<std::string, TaskChange>;
+
+/// Number of tasks in a group of changes with each outcome, returned by a
+/// `WriteBuffer::Writer`.
+struct WriteOutcome {
+  /// Number of tasks whose changes were written.
+  std::size_t written = 0;
+
+  /// Number of tasks whose changes were discarded because the task is no
+  /// longer in the store, for example because it has been evicted.
+  std::size_t missing = 0;
+
+  /// Number of tasks whose changes were discarded because writing them
+  /// failed.
+  std::size_t failed = 0;
+};
+
+/// Cumulative statistics from a WriteBuffer.
+struct WriteBufferStats {
+  /// Number of changes added to the buffer.
+  std::uint64_t changes_buffered = 0;
+
+  /// Number of task writes done by flushes.  Changes to the same task within
+  /// one flush window are coalesced into a single write, so this is at most
+  /// `changes_buffered`.
+  std::uint64_t tasks_written = 0;
+
+  /// Number of flushes that wrote at least one task.
+  std::uint64_t flushes = 0;
+
+  /// Number of task writes discarded because the task was no longer in the
+  /// store.
+  std::uint64_t tasks_missing = 0;
+
+  /// Number of task writes discarded because they failed.
+  std::uint64_t tasks_failed = 0;
+
+  /// Return the number of task writes that were discarded.
+  std::uint64_t tasks_discarded() const { return tasks_missing + tasks_failed; }
+};
+
+/// Collects changes to tasks, and writes them in groups on a background
+/// thread ("write-behind").
+///
+/// Changes to the same task are coalesced, so that when a task is changed
+/// several times in quick succession, only its final state is written.  The
+/// pending changes are flushed when the oldest of them has waited for the
+/// configured window, when `max_pending` tasks have pending changes, when
+/// `flush()` is called, and when the buffer is destroyed.
+class WriteBuffer {
+public:
+  /// Function that writes a group of changes to the store, and reports what
+  /// happened to each task's changes.
+  ///
+  /// It is called on the background thread, or on the thread that calls
+  /// `flush()`, and never concurrently with itself.  Changes are not retried:
+  /// those that were not written are counted in `stats()`.  If it throws, the
+  /// exception is logged, and every task in the group is counted as failed.
+  using Writer = std::function<WriteOutcome(const TaskChanges &)>;
+
+  /// Start the background thread.
+  WriteBuffer(std::chrono::milliseconds window, std::size_t max_pending,
+              Writer writer);
+
+  /// Flush pending changes, and stop the background thread.
+  ~WriteBuffer() noexcept;
+
+  WriteBuffer(const WriteBuffer &) = delete;
+  WriteBuffer(WriteBuffer &&) = delete;
+
+  WriteBuffer &operator=(const WriteBuffer &) = delete;
+  WriteBuffer &operator=(WriteBuffer &&) = delete;
+
+  /// Add a change to a task, coalescing it with any change that is already
+  /// pending for the same task.
+  void add(const std::string &task_id, const TaskChange &change);
+
+  /// Apply the pending changes for a task, including changes that are being
+  /// written, so that reads reflect them before they reach the store.
+  ///
+  /// @return true if the task has pending changes.
+  bool overlay(Task &task) const;
+
+  /// Write all pending changes now, returning when they have been written.
+  void flush();
+
+  /// Return a copy of the statistics collected so far.
+  WriteBufferStats stats() const;
+
+private:
+  void run();
+
+  /// Write the pending changes.  `lock` must hold `mtx`, and is released
+  /// while the writer runs.
+  void flush_locked(std::unique_lock<std::mutex> &lock);
+
+  const std::chrono::milliseconds window;
+  const std::size_t max_pending;
+  const Writer writer;
+
+  mutable std::mutex mtx; // guards the members below
+  std::condition_variable cv;
+  TaskChanges pending;
+  TaskChanges in_flight; // changes being written by the writer
+  bool flushing = false;
+  std::chrono::steady_clock::time_point oldest_pending_time;
+  WriteBufferStats totals;
+  bool stopping = false;
+  std::thread worker; // must be declared last, as it uses the members above
+};
+
+#endif // DITTO_QUICKSTART_WRITE_BUFFER_H